@@ -58,18 +58,7 @@ exports.sendMQTTData = function(sensor, data) {
  */
 exports.getLogs = function() {
   return new Promise((res, rej) => {
-
-    const kcs = KustoConnectionStringBuilder.withAadUserPasswordAuthentication(
-      `https://${CLUSTERNAME}.kusto.windows.net`,
-      username,
-      password
-    );
-
-    const kustoClient = new KustoClient(kcs);
-    kustoClient.execute("telemetrydb", "telemetryTable", (err, results) => {
-        if (err)return rej(new Error(err));
-        
-        var logs = createWrapperFromRawData(results);
+    return queryTelemetry().then((logs) => {
 
         var response = {};
 
@@ -88,12 +77,105 @@ exports.getLogs = function() {
         }
 
         return res(response);
+    }).catch((error) => {
+      return rej(error);
     });
     
   });
 };
 
 
+/**
+ * [Report, for every node and boot epoch, the messages received and the ones lost in the gaps of the counter]
+ */
+exports.getSequenceReport = function() {
+  return new Promise((res, rej) => {
+    return queryTelemetry().then((logs) => {
+      return res(sequenceReport(Object.keys(logs)));
+    }).catch((error) => {
+      return rej(error);
+    });
+  });
+};
+
+/**
+ * Read all the telemetry of the Data Explorer, one log per message ID
+ */
+function queryTelemetry() {
+  return new Promise((res, rej) => {
+
+    const kcs = KustoConnectionStringBuilder.withAadUserPasswordAuthentication(
+      `https://${CLUSTERNAME}.kusto.windows.net`,
+      username,
+      password
+    );
+
+    const kustoClient = new KustoClient(kcs);
+    kustoClient.execute("telemetrydb", "telemetryTable", (err, results) => {
+      if (err) return rej(new Error(err));
+      return res(createWrapperFromRawData(results));
+    });
+  });
+}
+
+/**
+ * Split a message ID "node:epoch:counter" written by the stations
+ * (see riotOS/weather/include/msgid.h), null for the older random IDs
+ * @param {String} ID [message ID]
+ */
+function parseMessageID(ID) {
+  const match = /^(.*):(\d+):(\d+)$/.exec(ID);
+  if (match === null) {
+    return null;
+  }
+  return { node: match[1], epoch: Number(match[2]), seq: Number(match[3]) };
+}
+
+/**
+ * Count, for every node and boot epoch, the messages received and the
+ * ones missing between the lowest and the highest counter
+ * @param {Array} IDs [message IDs, each one once]
+ */
+function sequenceReport(IDs) {
+  var counters = {};
+
+  for (const ID of IDs) {
+    const parsed = parseMessageID(ID);
+    if (parsed === null) {
+      continue;
+    }
+    const key = parsed.node + ":" + parsed.epoch;
+    if (counters[key] === undefined) {
+      counters[key] = { node: parsed.node, epoch: parsed.epoch, seqs: [] };
+    }
+    counters[key].seqs.push(parsed.seq);
+  }
+
+  var report = {};
+  for (const key in counters) {
+    const seqs = counters[key].seqs.sort((a, b) => a - b);
+    var gaps = [];
+
+    for (let i = 1; i < seqs.length; i++) {
+      if (seqs[i] > seqs[i - 1] + 1) {
+        gaps.push([seqs[i - 1] + 1, seqs[i] - 1]);
+      }
+    }
+
+    report[key] = {
+      node: counters[key].node,
+      epoch: counters[key].epoch,
+      received: seqs.length,
+      first: seqs[0],
+      last: seqs[seqs.length - 1],
+      missing: seqs[seqs.length - 1] - seqs[0] + 1 - seqs.length,
+      gaps: gaps,
+    };
+  }
+
+  return report;
+}
+
 /**
  * Create a wrapper from the raw data coming from the Analytic hub in a readable wrapper
  * @param {JSON} rawData [Raw data coming from hub]
@@ -110,6 +192,7 @@ function createWrapperFromRawData(rawData){
     var response = {}; // array containing the response of the log to the user
 
     var columns = []; // array containing the column's names
+    var duplicates = 0; // rows of a message already read
 
     for(const columnIndex in table.columns){
       columns.push(table.columns[columnIndex].name);
@@ -160,9 +243,19 @@ function createWrapperFromRawData(rawData){
         }
       }
 
+      // a message sent again (QoS 1 retry, outbox replay) keeps its ID
+      if(response[rowID] !== undefined){
+        duplicates++;
+        continue;
+      }
+
       response = Object.assign(response,{[rowID]:formattedRow});
     }
 
+    if(duplicates > 0){
+      console.log({log:"duplicated telemetry dropped", duplicates:duplicates});
+    }
+
     return response;
 
   }catch(err){
@@ -0,0 +1,57 @@
+/**
+ * [Pure fabrication that estimates the packet loss of the LoRa stations]
+ *
+ * The stations send unconfirmed uplinks, with an occasional confirmed
+ * heartbeat (see riotOS/weather/include/txplan.h), so losses are not
+ * reported by the network. Every uplink carries the LoRaWAN frame counter,
+ * incremented once per new frame: the gaps between the counters received
+ * are the frames lost.
+ */
+
+const MAX_GAP = 16384; // larger jumps are taken as a counter reset
+
+/**
+ * [Account for an uplink in the link statistics of a station]
+ * @param {Object} state [statistics stored for the station, null for the first uplink]
+ * @param {Object} uplink [counter, confirmed and time (unix) of the uplink]
+ * @return {Object} [updated statistics]
+ */
+exports.update = function (state, uplink) {
+  const counter = uplink.counter;
+  var link = Object.assign(
+    {
+      received: 0,
+      expected: 0,
+      duplicates: 0,
+      resets: 0,
+      lastCounter: null,
+      lastHeartbeat: null,
+    },
+    state
+  );
+
+  if (link.lastCounter === null) {
+    link.expected += 1;
+    link.received += 1;
+  } else if (counter === link.lastCounter) {
+    // retransmission of a frame already received
+    link.duplicates += 1;
+  } else if (counter > link.lastCounter && counter - link.lastCounter <= MAX_GAP) {
+    link.expected += counter - link.lastCounter;
+    link.received += 1;
+  } else {
+    // the station joined again or restarted, the counter starts over
+    link.resets += 1;
+    link.expected += 1;
+    link.received += 1;
+  }
+
+  link.lastCounter = counter;
+  link.lastSeen = uplink.time;
+  if (uplink.confirmed) {
+    link.lastHeartbeat = uplink.time;
+  }
+  link.loss = 1 - link.received / link.expected;
+
+  return link;
+};
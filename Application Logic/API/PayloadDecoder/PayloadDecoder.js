@@ -0,0 +1,307 @@
+/**
+ * [Pure fabrication that decodes the payloads sent by the LoRa weather stations]
+ */
+
+const FRAME_READING = 0x01; // single reading, see riotOS/weather/include/payload.h
+const FRAME_READING_LEN = 6;
+const FRAME_STATION = 0x02; // all the readings of a station
+const FRAME_STATION_HEADER_LEN = 4;
+const FRAME_SERIES = 0x03; // compressed block of readings, see riotOS/weather/include/tsbuf.h
+const FRAME_SERIES_HEADER_LEN = 9;
+const FRAME_BATCH = 0x04; // frames replayed from the outbox, see riotOS/weather/include/outbox.h
+const FRAME_BATCH_ENTRY_LEN = 3;
+const FRAME_SUMMARY = 0x05; // summary of a window of readings, see riotOS/weather/include/payload.h
+const FRAME_SUMMARY_LEN = 14;
+const FRAME_WIND = 0x06; // wind vector summary of a window, see riotOS/weather/include/payload.h
+const FRAME_WIND_LEN = 13;
+const FRAME_RAIN = 0x07; // rain counted by the gauge, see riotOS/weather/include/payload.h
+const FRAME_RAIN_LEN = 14;
+
+/**
+ * Fields of a JSON reading added by the summaries of the stations
+ */
+const SUMMARY_FIELDS = ["min", "max", "stddev", "count", "total", "peak", "tips", "span"];
+
+/**
+ * Sensors of the LoRa stations, in the order of their compact index, generated
+ * from riotOS/IOT-Assignment-3/topology.def by "npm run topology"
+ */
+const SENSORS = require("./topology");
+
+/**
+ * [Decode a raw payload, either a JSON document or a binary frame]
+ * @param {Buffer} buffer [raw payload as received from The Thing Network]
+ * @param {Number} now [unix time of reception, used to date compressed readings]
+ * @return {Array} [readings carried by the payload]
+ */
+exports.decode = function (buffer, now) {
+  if (buffer.length > 0 && buffer[0] === "{".charCodeAt(0)) {
+    const jsonLog = JSON.parse(buffer.toString("ascii"));
+    if (jsonLog.readings !== undefined) {
+      return decodeReadings(jsonLog);
+    }
+
+    var reading = {
+      sensorName: jsonLog.sensorName,
+      sensorType: jsonLog.sensorType,
+      origin: jsonLog.origin,
+      sensorID: jsonLog.sensorID,
+      value: jsonLog.value,
+    };
+
+    // a summary of a window or of the rain gauge carries its mean as value
+    for (const field of SUMMARY_FIELDS) {
+      if (jsonLog[field] !== undefined) {
+        reading[field] = jsonLog[field];
+      }
+    }
+    return [reading];
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_READING) {
+    if (buffer.length < FRAME_READING_LEN) {
+      throw new Error("truncated reading frame");
+    }
+
+    return [
+      createReading(buffer.readUInt8(3), buffer.readInt16BE(4), {
+        seq: buffer.readUInt16BE(1),
+      }),
+    ];
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_STATION) {
+    if (
+      buffer.length < FRAME_STATION_HEADER_LEN ||
+      (buffer.length - FRAME_STATION_HEADER_LEN) % 2 !== 0
+    ) {
+      throw new Error("truncated station frame");
+    }
+
+    const seq = buffer.readUInt16BE(1);
+    const first = buffer.readUInt8(3);
+    const count = (buffer.length - FRAME_STATION_HEADER_LEN) / 2;
+    var readings = [];
+    for (let i = 0; i < count; i++) {
+      readings.push(
+        createReading(first + i, buffer.readInt16BE(4 + 2 * i), { seq: seq })
+      );
+    }
+    return readings;
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_SERIES) {
+    return decodeSeries(buffer, now);
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_BATCH) {
+    return decodeBatch(buffer, now);
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_SUMMARY) {
+    if (buffer.length < FRAME_SUMMARY_LEN) {
+      throw new Error("truncated summary frame");
+    }
+
+    return [
+      createReading(buffer.readUInt8(3), buffer.readInt16BE(10), {
+        seq: buffer.readUInt16BE(1),
+        count: buffer.readUInt16BE(4),
+        min: buffer.readInt16BE(6) / 10,
+        max: buffer.readInt16BE(8) / 10,
+        stddev: buffer.readInt16BE(12) / 10,
+      }),
+    ];
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_WIND) {
+    if (buffer.length < FRAME_WIND_LEN) {
+      throw new Error("truncated wind frame");
+    }
+
+    const seq = buffer.readUInt16BE(1);
+    const count = buffer.readUInt16BE(5);
+    return [
+      createReading(buffer.readUInt8(3), buffer.readInt16BE(7), {
+        seq: seq,
+        count: count,
+      }),
+      createReading(buffer.readUInt8(4), buffer.readInt16BE(9), {
+        seq: seq,
+        count: count,
+        gust: buffer.readInt16BE(11) / 10,
+      }),
+    ];
+  }
+
+  if (buffer.length > 0 && buffer[0] === FRAME_RAIN) {
+    if (buffer.length < FRAME_RAIN_LEN) {
+      throw new Error("truncated rain frame");
+    }
+
+    return [
+      createReading(buffer.readUInt8(3), buffer.readInt16BE(10), {
+        seq: buffer.readUInt16BE(1),
+        tips: buffer.readUInt16BE(4),
+        span: buffer.readUInt16BE(6),
+        total: buffer.readInt16BE(8) / 10,
+        peak: buffer.readInt16BE(12) / 10,
+      }),
+    ];
+  }
+
+  throw new Error("unknown payload format");
+};
+
+/**
+ * Decode a JSON document carrying several readings of a station, as the
+ * station and wind documents do
+ * @param {Object} jsonLog [parsed document]
+ */
+function decodeReadings(jsonLog) {
+  return jsonLog.readings.map((entry) => {
+    const sensor = SENSORS.find((s) => s.sensorID === entry.sensorID);
+    if (sensor === undefined) {
+      throw new Error("unknown sensor " + entry.sensorID);
+    }
+
+    var reading = Object.assign(
+      {
+        sensorName: sensor.sensorName,
+        sensorType: sensor.sensorType,
+        origin: jsonLog.origin,
+      },
+      entry
+    );
+    if (jsonLog.count !== undefined) {
+      reading.count = jsonLog.count;
+    }
+    return reading;
+  });
+}
+
+/**
+ * Create a reading from the compact sensor index and the value in tenths
+ * @param {Number} index [compact index of the sensor]
+ * @param {Number} tenths [value in tenths of the sensor unit]
+ * @param {Object} extra [additional fields of the reading]
+ */
+function createReading(index, tenths, extra) {
+  const sensor = SENSORS[index];
+  if (sensor === undefined) {
+    throw new Error("unknown sensor index " + index);
+  }
+
+  return Object.assign(
+    {
+      sensorName: sensor.sensorName,
+      sensorType: sensor.sensorType,
+      origin: "physical Device",
+      sensorID: sensor.sensorID,
+      value: tenths / 10,
+    },
+    extra
+  );
+}
+
+/**
+ * Decode a compressed block of readings of a single sensor
+ * @param {Buffer} buffer [raw frame]
+ * @param {Number} now [unix time of reception]
+ */
+function decodeSeries(buffer, now) {
+  if (buffer.length < FRAME_SERIES_HEADER_LEN) {
+    throw new Error("truncated series frame");
+  }
+
+  const index = buffer.readUInt8(1);
+  const count = buffer.readUInt8(2);
+  const age = buffer.readUInt32BE(3);
+  var value = buffer.readInt16BE(7);
+  var time = now - age;
+  var delta = 0;
+
+  const bits = new BitReader(buffer, FRAME_SERIES_HEADER_LEN);
+  var readings = [createReading(index, value, { timestamp: time })];
+
+  for (let i = 1; i < count; i++) {
+    delta += bits.readVariable([0, 7, 9, 32]);
+    value += bits.readVariable([0, 4, 8, 17]);
+    time += delta;
+    readings.push(createReading(index, value, { timestamp: time }));
+  }
+
+  return readings;
+}
+
+/**
+ * Decode the frames packed by the outbox of a station, each one dated from
+ * the time it waited on the device
+ * @param {Buffer} buffer [raw frame]
+ * @param {Number} now [unix time of reception]
+ */
+function decodeBatch(buffer, now) {
+  var readings = [];
+  var pos = 1;
+
+  while (pos < buffer.length) {
+    if (pos + FRAME_BATCH_ENTRY_LEN > buffer.length) {
+      throw new Error("truncated batch frame");
+    }
+
+    const age = buffer.readUInt16BE(pos);
+    const len = buffer.readUInt8(pos + 2);
+    pos += FRAME_BATCH_ENTRY_LEN;
+    if (len === 0 || pos + len > buffer.length) {
+      throw new Error("truncated batch frame");
+    }
+
+    const frame = buffer.slice(pos, pos + len);
+    if (frame[0] === FRAME_BATCH) {
+      throw new Error("nested batch frame");
+    }
+    for (const reading of exports.decode(frame, now - age)) {
+      readings.push(Object.assign({ timestamp: now - age }, reading));
+    }
+    pos += len;
+  }
+
+  return readings;
+}
+
+/**
+ * Class that reads a stream of bits, most significant bit first
+ * @param {Buffer} buffer [data to read]
+ * @param {Number} offset [first byte of the stream]
+ */
+function BitReader(buffer, offset) {
+  let pos = offset * 8;
+
+  this.read = function (n) {
+    var val = 0;
+    for (let i = 0; i < n; i++, pos++) {
+      if (pos >> 3 >= buffer.length) {
+        throw new Error("truncated bit stream");
+      }
+      val = val * 2 + ((buffer[pos >> 3] >> (7 - (pos & 7))) & 1);
+    }
+    return val;
+  };
+
+  this.readSigned = function (n) {
+    const val = this.read(n);
+    return val >= Math.pow(2, n - 1) ? val - Math.pow(2, n) : val;
+  };
+
+  /**
+   * Read a value prefixed by '0', '10', '110' or '111', selecting one of the
+   * four widths (a width of 0 means the value is 0)
+   */
+  this.readVariable = function (widths) {
+    let prefix = 0;
+    while (prefix < widths.length - 1 && this.read(1) === 1) {
+      prefix++;
+    }
+    return widths[prefix] === 0 ? 0 : this.readSigned(widths[prefix]);
+  };
+}
@@ -0,0 +1,17 @@
+// generated by topology.py from IOT-Assignment-3/topology.def, do not edit
+
+/**
+ * Sensors of the stations, in the order of their compact index
+ */
+module.exports = [
+  { sensorID: "2c107530-743b-11ea-9072-737364a53ef5", sensorName: "temperatureCharlie", sensorType: "temperature" },
+  { sensorID: "2c107531-743b-11ea-9072-737364a53ef5", sensorName: "humidityCharlie", sensorType: "humidity" },
+  { sensorID: "2c107532-743b-11ea-9072-737364a53ef5", sensorName: "windDirectionCharlie", sensorType: "WindDirection" },
+  { sensorID: "2c107533-743b-11ea-9072-737364a53ef5", sensorName: "windIntensityCharlie", sensorType: "WindIntensity" },
+  { sensorID: "2c107534-743b-11ea-9072-737364a53ef5", sensorName: "rainHeightCharlie", sensorType: "rain" },
+  { sensorID: "2c107535-743b-11ea-9072-737364a53ef5", sensorName: "temperatureTango", sensorType: "temperature" },
+  { sensorID: "2c107536-743b-11ea-9072-737364a53ef5", sensorName: "humidityTango", sensorType: "humidity" },
+  { sensorID: "2c107537-743b-11ea-9072-737364a53ef5", sensorName: "windDirectionTango", sensorType: "WindDirection" },
+  { sensorID: "2c107538-743b-11ea-9072-737364a53ef5", sensorName: "windIntensityTango", sensorType: "WindIntensity" },
+  { sensorID: "2c107539-743b-11ea-9072-737364a53ef5", sensorName: "rainHeightTango", sensorType: "rain" },
+];
@@ -43,6 +43,26 @@ exports.createRecord = function (path, object) {
   });
 };
 
+/**
+ * [atomically replace a record with a value computed from its current one]
+ * @param  {String} path [the path of the record]
+ * @param  {Function} update [called with the current value, null if none, returns the new one]
+ */
+exports.transactRecord = function (path, update) {
+  return new Promise((res, rej) => {
+    admin
+      .database()
+      .ref(path)
+      .transaction(update)
+      .then((result) => {
+        return res(result.snapshot.val());
+      })
+      .catch((error) => {
+        return rej(error);
+      });
+  });
+};
+
 /**
  * [Local version of update record]
  * @author Giulio Serra <serra.1904089@studenti.uniroma1.it>
@@ -4,6 +4,8 @@ const moment = require("moment");
 const hub = require("./AnalyticHub/AnalyticHub");
 const storage = require("./PersistanceStorage/PersistanceStorage");
 const model = require("./ActivityModel/Model");
+const decoder = require("./PayloadDecoder/PayloadDecoder");
+const linkMonitor = require("./LinkMonitor/LinkMonitor");
 const REGION = "europe-west1"; // region of the server where all the functions will be deployed
 const uuidv1 = require("uuid/v1");
 const cors = require("cors")({ origin: true });
@@ -190,6 +192,26 @@ exports.getLogs = functions.region(REGION).https.onRequest((req, res) => {
   });
 });
 
+/**
+ * [Get, for every station and boot, the messages received and the ones lost]
+ */
+exports.getSequenceReport = functions
+  .region(REGION)
+  .https.onRequest((req, res) => {
+    cors(req, res, () => {
+      return hub
+        .getSequenceReport()
+        .then((report) => {
+          return res.status(200).send(formatResponse(report, "ok", "200"));
+        })
+        .catch((error) => {
+          return res
+            .status(500)
+            .send(formatResponse(null, error.message, "500"));
+        });
+    });
+  });
+
 /**
  * [Get all the activity log of a user inside the database ]
  * @author Giulio Serra <serra.1904089@studenti.uniroma1.it>
@@ -298,31 +320,44 @@ exports.postTTNLog = functions.region(REGION).https.onRequest((req, res) => {
       }
 
       const rawPayload = req.body.payload_raw; // raw payload in base 64
-      const buffer = new Buffer(rawPayload, "base64");
-      const text = buffer.toString("ascii");
+      const buffer = Buffer.from(rawPayload, "base64");
 
-      console.log({ log: "TTn deconding complete.", data: text });
+      const readings = decoder.decode(buffer, moment().unix());
+      console.log({ log: "TTn deconding complete.", data: readings });
 
-      var jsonLog = JSON.parse(text);
-      console.log({ log: "Json Decoding", decodedJsonObject: jsonLog });
+      var logs = {}; // new logs to store in the database
+      for (const reading of readings) {
+        logs[uuidv1()] = Object.assign({ timestamp: moment().unix() }, reading);
+      }
 
-      const log = {
-        // new log to store in the database
+      var updates = [storage.updateRecord("Log", logs)];
 
-        sensorName: jsonLog.sensorName,
-        sensorType: jsonLog.sensorType,
-        origin: jsonLog.origin,
-        sensorID: jsonLog.sensorID,
-        value: jsonLog.value,
-        timestamp: moment().unix(),
-      };
+      // packet loss of the station, from the gaps in the frame counter
+      if (req.body.dev_id !== undefined && req.body.counter !== undefined) {
+        const uplink = {
+          counter: req.body.counter,
+          confirmed: req.body.confirmed === true,
+          time: moment().unix(),
+        };
+        updates.push(
+          storage
+            .transactRecord("Link/" + req.body.dev_id, (state) => {
+              return linkMonitor.update(state, uplink);
+            })
+            .then((link) => {
+              return console.log({
+                log: "TTn link of " + req.body.dev_id,
+                loss: link.loss,
+                received: link.received,
+                expected: link.expected,
+              });
+            })
+        );
+      }
 
-      storage
-        .updateRecord("Log", { [uuidv1()]: log })
+      Promise.all(updates)
         .then(() => {
-          return res
-            .status(200)
-            .send(formatResponse({ [uuidv1()]: log }, "ok", "200"));
+          return res.status(200).send(formatResponse(logs, "ok", "200"));
         })
         .catch((error) => {
           return res.status(500).send(formatResponse(error, "error", "500"));
@@ -0,0 +1,461 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Load generator simulating many weather stations against a
+ *              MQTT-SN gateway
+ *
+ * emcute serves a single client per process, so every virtual station
+ * speaks MQTT-SN on its own UDP socket with its own client ID: CONNECT,
+ * REGISTER of the topic, then a PUBLISH of a station payload every period,
+ * with at most one QoS 1 publication waiting for its PUBACK. The stations
+ * are driven by one thread that polls their sockets every LOADGEN_TICK_US,
+ * so latencies are measured with that resolution.
+ *
+ * Built with LOADGEN=1, meant for BOARD=native.
+ */
+
+#ifdef LOADGEN
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+#include "net/ipv6/addr.h"
+#include "net/sock/udp.h"
+
+#include "weather.h"
+#include "payload.h"
+#include "registry.h"
+#include "hist.h"
+#include "loadgen.h"
+#include "mqttsn.h"
+
+/**
+ * @brief   Maximum number of simulated stations
+ */
+#ifndef LOADGEN_STATIONS_MAX
+#define LOADGEN_STATIONS_MAX    (1024U)
+#endif
+
+/**
+ * @brief   First local UDP port, station i uses LOADGEN_PORT_BASE + i
+ */
+#ifndef LOADGEN_PORT_BASE
+#define LOADGEN_PORT_BASE       (20000U)
+#endif
+
+/**
+ * @brief   Interval between two polls of the stations
+ */
+#ifndef LOADGEN_TICK_US
+#define LOADGEN_TICK_US         (1U * US_PER_MS)
+#endif
+
+/**
+ * @brief   Time after which a request without reply is counted as lost and
+ *          sent again
+ */
+#ifndef LOADGEN_TIMEOUT_US
+#define LOADGEN_TIMEOUT_US      (5U * US_PER_SEC)
+#endif
+
+/**
+ * @brief   Stations connecting in the same tick, spreads the connection storm
+ */
+#ifndef LOADGEN_CONNECT_BURST
+#define LOADGEN_CONNECT_BURST   (8U)
+#endif
+
+/**
+ * @brief   Interval between two reports while running
+ */
+#ifndef LOADGEN_REPORT_US
+#define LOADGEN_REPORT_US       (10U * US_PER_SEC)
+#endif
+
+#define LOADGEN_ID_MAXLEN       (24U)
+#define LOADGEN_TOPIC_MAXLEN    (64U)
+
+#define LOADGEN_KEEPALIVE_S     (900U)
+
+typedef enum {
+    STATION_IDLE,           /* not connected yet */
+    STATION_CONNECTING,     /* CONNECT sent */
+    STATION_REGISTERING,    /* REGISTER sent */
+    STATION_READY,          /* publishing */
+} _state_t;
+
+typedef struct {
+    sock_udp_t sock;
+    uint32_t deadline;      /* time of the next publication */
+    uint32_t sent_at;       /* time the pending request was sent */
+    uint16_t topic_id;
+    uint16_t msg_id;        /* ID of the last request sent */
+    uint32_t seq;           /* counter of the message IDs of the station */
+    uint8_t state;
+    uint8_t pending;        /* a request is waiting for its reply */
+} _station_t;
+
+static _station_t _stations[LOADGEN_STATIONS_MAX];
+static char _stack[THREAD_STACKSIZE_DEFAULT + 1024];
+static mutex_t _lock = MUTEX_INIT;
+
+/* configuration of the run, set before the thread starts */
+static sock_udp_ep_t _gw;
+static unsigned _numof;
+static uint32_t _period_us;
+static unsigned _qos;
+static char _topic[LOADGEN_TOPIC_MAXLEN];
+static volatile bool _running;     /* cleared to stop the thread */
+static volatile bool _active;      /* the thread is alive */
+
+/* results of the run, protected by _lock */
+static struct {
+    uint32_t start;
+    uint32_t connected;
+    uint32_t published;
+    uint32_t acked;
+    uint32_t rejected;
+    uint32_t timeouts;
+    uint32_t errors;
+    hist_t connect_us;
+    hist_t publish_us;
+} _stats;
+
+static int _send(_station_t *st, const uint8_t *buf, size_t len, uint32_t now)
+{
+    if (sock_udp_send(&st->sock, buf, len, NULL) < 0) {
+        /* connect again on the next tick */
+        _stats.errors++;
+        st->state = STATION_IDLE;
+        return -1;
+    }
+    st->sent_at = now;
+    st->pending = 1;
+    return 0;
+}
+
+static void _connect(_station_t *st, unsigned i, uint32_t now)
+{
+    uint8_t buf[6 + LOADGEN_ID_MAXLEN];
+    char id[LOADGEN_ID_MAXLEN];
+    int id_len = snprintf(id, sizeof(id), "sim%05u", i);
+    size_t pos = mqttsn_header(buf, 4 + id_len, MQTTSN_CONNECT);
+
+    buf[pos++] = MQTTSN_FLAG_CS;
+    buf[pos++] = MQTTSN_PROTOCOL_ID;
+    mqttsn_put_u16(&buf[pos], LOADGEN_KEEPALIVE_S);
+    pos += 2;
+    memcpy(&buf[pos], id, id_len);
+
+    st->state = STATION_CONNECTING;
+    _send(st, buf, pos + id_len, now);
+}
+
+static void _register(_station_t *st, uint32_t now)
+{
+    uint8_t buf[6 + LOADGEN_TOPIC_MAXLEN];
+    size_t topic_len = strlen(_topic);
+    size_t pos = mqttsn_header(buf, 4 + topic_len, MQTTSN_REGISTER);
+
+    mqttsn_put_u16(&buf[pos], 0);
+    mqttsn_put_u16(&buf[pos + 2], ++st->msg_id);
+    memcpy(&buf[pos + 4], _topic, topic_len);
+
+    st->state = STATION_REGISTERING;
+    _send(st, buf, pos + 4 + topic_len, now);
+}
+
+/* publish the readings of a station of the topology with random values */
+static void _publish(_station_t *st, unsigned i, uint32_t now)
+{
+    uint8_t buf[9 + PAYLOAD_STATION_JSON_MAXLEN];
+    char data[PAYLOAD_STATION_JSON_MAXLEN];
+    const registry_station_t *rst = registry_station(i % registry_stations_numof);
+    weatherStation ws = { .name = rst->name, .numof = rst->numof };
+
+    for (unsigned k = 0; k < rst->numof; k++) {
+        const registry_sensor_t *snr = registry_sensor(rst->first + k);
+        ws.sensors[k] = (sensor){ snr->ID, rand() % 1000,
+                                  snr->sensorName, snr->sensorType, snr->kind };
+    }
+
+    /* every simulated station is a node of its own, in the epoch of the board */
+    char node[LOADGEN_ID_MAXLEN];
+    msgid_t id;
+
+    msgid_peek(&id);
+    snprintf(node, sizeof(node), "sim%05u", i);
+    id.node = node;
+    id.seq = st->seq++;
+
+    int len = payload_station_json(data, sizeof(data), &ws, &id);
+    if (len < 0) {
+        _stats.errors++;
+        return;
+    }
+
+    size_t pos = mqttsn_header(buf, 5 + len, MQTTSN_PUBLISH);
+    buf[pos] = _qos ? MQTTSN_FLAG_QOS1 : 0;
+    mqttsn_put_u16(&buf[pos + 1], st->topic_id);
+    mqttsn_put_u16(&buf[pos + 3], _qos ? ++st->msg_id : 0);
+    memcpy(&buf[pos + 5], data, len);
+
+    if (sock_udp_send(&st->sock, buf, pos + 5 + len, NULL) < 0) {
+        _stats.errors++;
+    }
+    else {
+        _stats.published++;
+        st->sent_at = now;
+        st->pending = _qos;
+    }
+    st->deadline += _period_us;
+    /* do not try to catch up when the generator falls behind */
+    if ((int32_t)(now - st->deadline) > 0) {
+        st->deadline = now + _period_us;
+    }
+}
+
+/* handle the replies received by a station */
+static void _receive(_station_t *st, uint32_t now)
+{
+    uint8_t buf[16];
+    ssize_t len;
+
+    while ((len = sock_udp_recv(&st->sock, buf, sizeof(buf), 0, NULL)) >= 0) {
+        const uint8_t *body;
+        uint8_t type;
+
+        len = mqttsn_parse(buf, len, &type, &body);
+        if (len < 0) {
+            continue;
+        }
+
+        if (type == MQTTSN_CONNACK && len >= 1 && st->state == STATION_CONNECTING) {
+            st->pending = 0;
+            if (body[0] == MQTTSN_ACCEPTED) {
+                _stats.connected++;
+                hist_add(&_stats.connect_us, now - st->sent_at);
+                _register(st, now);
+            }
+            else {
+                _stats.rejected++;
+                st->state = STATION_IDLE;
+            }
+        }
+        else if (type == MQTTSN_REGACK && len >= 5 && st->state == STATION_REGISTERING) {
+            st->pending = 0;
+            if (body[4] == MQTTSN_ACCEPTED) {
+                st->topic_id = mqttsn_get_u16(&body[0]);
+                st->state = STATION_READY;
+                /* spread the publications over the period */
+                st->deadline = now + (uint32_t)rand() % _period_us;
+            }
+            else {
+                _stats.rejected++;
+                st->state = STATION_IDLE;
+            }
+        }
+        else if (type == MQTTSN_PUBACK && len >= 5 && st->pending &&
+                 mqttsn_get_u16(&body[2]) == st->msg_id) {
+            st->pending = 0;
+            if (body[4] == MQTTSN_ACCEPTED) {
+                _stats.acked++;
+                hist_add(&_stats.publish_us, now - st->sent_at);
+            }
+            else {
+                _stats.rejected++;
+            }
+        }
+    }
+}
+
+static void _disconnect(_station_t *st)
+{
+    uint8_t buf[2] = { 2, MQTTSN_DISCONNECT };
+
+    if (st->state != STATION_IDLE) {
+        sock_udp_send(&st->sock, buf, sizeof(buf), NULL);
+    }
+    sock_udp_close(&st->sock);
+}
+
+static void _print_hist(const char *name, const hist_t *h)
+{
+    printf("%s latency (us): n=%" PRIu32 " min=%" PRIu32 " mean=%" PRIu32
+           " p50=%" PRIu32 " p90=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32 "\n",
+           name, h->count, h->count ? h->min : 0, hist_mean(h),
+           hist_percentile(h, 50), hist_percentile(h, 90),
+           hist_percentile(h, 99), h->max);
+}
+
+static void _report(void)
+{
+    mutex_lock(&_lock);
+
+    uint32_t elapsed_ms = (xtimer_now_usec() - _stats.start) / US_PER_MS;
+    uint32_t done = _qos ? _stats.acked : _stats.published;
+
+    printf("loadgen: %u stations, %" PRIu32 " s, %" PRIu32 " connected, %" PRIu32
+           " published, %" PRIu32 " acked, %" PRIu32 " rejected, %" PRIu32
+           " timeouts, %" PRIu32 " errors\n",
+           _numof, elapsed_ms / MS_PER_SEC, _stats.connected, _stats.published,
+           _stats.acked, _stats.rejected, _stats.timeouts, _stats.errors);
+    printf("throughput: %" PRIu32 " msg/s\n",
+           elapsed_ms ? (uint32_t)((uint64_t)done * MS_PER_SEC / elapsed_ms) : 0);
+    _print_hist("connect", &_stats.connect_us);
+    if (_qos) {
+        _print_hist("publish", &_stats.publish_us);
+    }
+
+    mutex_unlock(&_lock);
+}
+
+static void *_loadgen_thread(void *arg)
+{
+    (void)arg;
+    unsigned opened = 0;
+    uint32_t next_report = xtimer_now_usec() + LOADGEN_REPORT_US;
+
+    for (unsigned i = 0; i < _numof; i++) {
+        sock_udp_ep_t local = SOCK_IPV6_EP_ANY;
+
+        local.port = LOADGEN_PORT_BASE + i;
+        /* the message IDs go on from the previous run */
+        uint32_t seq = _stations[i].seq;
+        memset(&_stations[i], 0, sizeof(_stations[i]));
+        _stations[i].seq = seq;
+        if (sock_udp_create(&_stations[i].sock, &local, &_gw, 0) < 0) {
+            printf("loadgen: unable to open the socket of station %u\n", i);
+            break;
+        }
+        opened++;
+    }
+
+    while (_running) {
+        unsigned burst = 0;
+        uint32_t now = xtimer_now_usec();
+
+        mutex_lock(&_lock);
+        for (unsigned i = 0; i < opened; i++) {
+            _station_t *st = &_stations[i];
+
+            _receive(st, now);
+
+            if (st->pending && (now - st->sent_at) >= LOADGEN_TIMEOUT_US) {
+                /* the request or its reply got lost, start over */
+                _stats.timeouts++;
+                st->pending = 0;
+                if (st->state != STATION_READY) {
+                    st->state = STATION_IDLE;
+                }
+            }
+
+            if (st->state == STATION_IDLE && burst < LOADGEN_CONNECT_BURST) {
+                burst++;
+                _connect(st, i, now);
+            }
+            else if (st->state == STATION_READY && !st->pending &&
+                     (int32_t)(now - st->deadline) >= 0) {
+                _publish(st, i, now);
+            }
+        }
+        mutex_unlock(&_lock);
+
+        if ((int32_t)(now - next_report) >= 0) {
+            _report();
+            next_report += LOADGEN_REPORT_US;
+        }
+
+        xtimer_usleep(LOADGEN_TICK_US);
+    }
+
+    for (unsigned i = 0; i < opened; i++) {
+        _disconnect(&_stations[i]);
+    }
+    _report();
+    _active = false;
+
+    return NULL;
+}
+
+static void _usage(void)
+{
+    puts("Usage: loadgen <start|stop|stats>\n"
+         "  loadgen start <gw addr> <gw port> <stations> <period ms> [QoS] [topic]");
+}
+
+int loadgen_cmd(int argc, char **argv)
+{
+    if (argc < 2) {
+        _usage();
+        return 1;
+    }
+
+    if (strcmp(argv[1], "stats") == 0) {
+        _report();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "stop") == 0) {
+        _running = false;
+        return 0;
+    }
+
+    if (strcmp(argv[1], "start") != 0 || argc < 6) {
+        _usage();
+        return 1;
+    }
+
+    if (_active) {
+        puts("loadgen: already running, stop it first");
+        return 1;
+    }
+
+    _gw = (sock_udp_ep_t){ .family = AF_INET6, .port = atoi(argv[3]) };
+    if (ipv6_addr_from_str((ipv6_addr_t *)&_gw.addr.ipv6, argv[2]) == NULL) {
+        puts("error parsing IPv6 address");
+        return 1;
+    }
+
+    _numof = strtoul(argv[4], NULL, 0);
+    _period_us = strtoul(argv[5], NULL, 0) * US_PER_MS;
+    _qos = (argc >= 7) ? (atoi(argv[6]) != 0) : 1;
+    if (_numof == 0 || _numof > LOADGEN_STATIONS_MAX || _period_us == 0) {
+        printf("loadgen: 1 to %u stations, period above 0\n", LOADGEN_STATIONS_MAX);
+        return 1;
+    }
+
+    snprintf(_topic, sizeof(_topic), "%s", (argc >= 8) ? argv[7] : "loadgen");
+
+    memset(&_stats, 0, sizeof(_stats));
+    hist_init(&_stats.connect_us);
+    hist_init(&_stats.publish_us);
+    _stats.start = xtimer_now_usec();
+    _running = true;
+    _active = true;
+
+    if (thread_create(_stack, sizeof(_stack), THREAD_PRIORITY_MAIN + 1, 0,
+                      _loadgen_thread, NULL, "loadgen") < 0) {
+        _running = false;
+        _active = false;
+        puts("loadgen: unable to start the thread");
+        return 1;
+    }
+
+    printf("loadgen: %u stations publishing on '%s' every %" PRIu32 " ms, QoS %u\n",
+           _numof, _topic, _period_us / US_PER_MS, _qos);
+    return 0;
+}
+
+#endif /* LOADGEN */
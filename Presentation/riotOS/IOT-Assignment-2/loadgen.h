@@ -0,0 +1,29 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Load generator simulating many weather stations against a
+ *              MQTT-SN gateway
+ */
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Shell command starting, stopping and reporting the load generator
+ */
+int loadgen_cmd(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOADGEN_H */
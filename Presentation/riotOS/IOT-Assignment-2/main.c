@@ -20,6 +20,8 @@
  * @}
  */
 
+#include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -27,16 +29,37 @@
 #include <stdbool.h>
 
 
+#include "log.h"
 #include "shell.h"
 #include "msg.h"
+#include "xtimer.h"
 #include "net/emcute.h"
 #include "net/ipv6/addr.h"
 
+#include "weather.h"
+#include "payload.h"
+#include "registry.h"
+#include "topic_cache.h"
+#include "pubq.h"
+#include "outbox.h"
+#include "msgid.h"
+#include "trace.h"
+#include "perf.h"
+
+#ifdef LOADGEN
+#include "loadgen.h"
+#endif
+
 
 #define EMCUTE_PORT         (1883U)
+#ifndef EMCUTE_ID
 #define EMCUTE_ID           ("gertrud")
+#endif
 #define EMCUTE_PRIO         (THREAD_PRIORITY_MAIN - 1)
 
+#define PUBQ_PORT           (EMCUTE_PORT + 1U)
+#define PUBQ_PRIO           (THREAD_PRIORITY_MAIN - 1)
+
 #define NUMOFSUBS           (16U)
 #define TOPIC_MAXLEN        (64U)
 
@@ -47,29 +70,38 @@ static emcute_sub_t subscriptions[NUMOFSUBS];
 static char topics[NUMOFSUBS][TOPIC_MAXLEN];
 static bool isSensorSelected = false;
 
-/**
-*Struct declaration that rappresent all the five sensors mounted on the board(weather station)
-*/
-typedef struct 
-{
-  char *ID;
-  float value;
-  char *sensorName;
-  char *sensorType;
-
-}sensor; 
-
-/**
-*Struct declaration thta rappresents the station
-*/
-typedef struct station{
-    sensor sensors[5];
-    char *name;
-}weatherStation;
+static weatherStation selectedStation; /* the selected station, values are the latest readings */
+static sensor currentSensor;
+static unsigned currentSlot;        /* position of the selected sensor in its station */
+static bool isStationSelected = false;
+static unsigned currentStation;     /* registry index of the selected station */
+
+/* publications that failed for lack of a gateway, replayed once it is back */
+static outbox_t outbox;
+
+/* an outbox record is the publication flags, the topic name with its
+ * terminating zero and the payload */
+#define OUTBOX_RECORD_MAXLEN (1U + TOPIC_MAXLEN + PAYLOAD_STATION_JSON_MAXLEN)
+static char outboxRecord[OUTBOX_RECORD_MAXLEN];
+
+/* stages of the publication pipeline timed for the perf command */
+enum {
+    PERF_READ,      /* sensor reads */
+    PERF_ENCODE,    /* JSON documents */
+    PERF_PUB,       /* emcute_pub */
+    PERF_PUBLISH,   /* whole publication: outbox, topic and emcute_pub */
+    PERF_NUMOF,
+};
 
+static perf_stage_t perfStages[PERF_NUMOF] = {
+    [PERF_READ] = PERF_STAGE_INIT("read"),
+    [PERF_ENCODE] = PERF_STAGE_INIT("encode"),
+    [PERF_PUB] = PERF_STAGE_INIT("pub"),
+    [PERF_PUBLISH] = PERF_STAGE_INIT("publish"),
+};
 
-static weatherStation stations[2];
-static sensor currentSensor;
+static int publishPayload(const char *topic, const char *payload, size_t len, unsigned flags);
+static int replayOutbox(void);
 
 
 /*
@@ -141,6 +173,9 @@ static int cmd_con(int argc, char **argv)
         len = strlen(message);
     }
 
+    /* topic IDs registered on the previous connection are not valid anymore */
+    topic_cache_reset();
+
     if (emcute_con(&gw, true, topic, message, len, 0) != EMCUTE_OK) {
         printf("error: unable to connect to [%s]:%i\n", argv[1], (int)gw.port);
         return 1;
@@ -148,6 +183,8 @@ static int cmd_con(int argc, char **argv)
     printf("Successfully connected to gateway at [%s]:%i\n",
            argv[1], (int)gw.port);
 
+    replayOutbox();
+
     return 0;
 }
 
@@ -161,6 +198,7 @@ static int cmd_discon(int argc, char **argv)
     (void)argv;
 
     int res = emcute_discon();
+    topic_cache_reset();
     if (res == EMCUTE_NOGW) {
         puts("error: not connected to any broker");
         return 1;
@@ -179,7 +217,6 @@ static int cmd_discon(int argc, char **argv)
  */
 static int cmd_pub(int argc, char **argv)
 {
-    emcute_topic_t t;
     unsigned flags = EMCUTE_QOS_0;
 
     if (argc < 3) {
@@ -192,26 +229,7 @@ static int cmd_pub(int argc, char **argv)
         flags |= get_qos(argv[3]);
     }
 
-    printf("pub with topic: %s and name %s and flags 0x%02x\n", argv[1], argv[2], (int)flags);
-
-    /* step 1: get topic id */
-    t.name = argv[1];
-    if (emcute_reg(&t) != EMCUTE_OK) {
-        puts("error: unable to obtain topic ID");
-        return 1;
-    }
-
-    /* step 2: publish data */
-    if (emcute_pub(&t, argv[2], strlen(argv[2]), flags) != EMCUTE_OK) {
-        printf("error: unable to publish data to topic '%s [%i]'\n",
-                t.name, (int)t.id);
-        return 1;
-    }
-
-    printf("Published %i bytes to topic '%s [%i]'\n",
-            (int)strlen(argv[2]), t.name, t.id);
-
-    return 0;
+    return publishPayload(argv[1], argv[2], strlen(argv[2]), flags);
 }
 
 /*
@@ -313,23 +331,20 @@ static int cmd_will(int argc, char **argv)
  * Get the current temperaturature value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_Temperature(void){
+static weather_value_t get_Temperature(void){
 
     	int MAX_TEMP = 100;
-        float coeff = ((float)rand()/(float)(RAND_MAX));
-        return MAX_TEMP * coeff;
+        return rand() % (MAX_TEMP * WEATHER_VALUE_SCALE + 1);
 }
 
 /*
  * Get the current humidity value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_Humidity(void){
+static weather_value_t get_Humidity(void){
 
     int MAX_HUMIDITY = 100;
-        float coeff = ((float)rand()/(float)(RAND_MAX));
-
-        return MAX_HUMIDITY * coeff;
+        return rand() % (MAX_HUMIDITY * WEATHER_VALUE_SCALE + 1);
    
 }
 
@@ -337,36 +352,64 @@ static float get_Humidity(void){
  * Get the current rain height value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_Rain(void){
+static weather_value_t get_Rain(void){
 
     int MAX_RAIN_HEIGHT = 50;
-    float coeff = ((float)rand()/(float)(RAND_MAX));
-
-    return MAX_RAIN_HEIGHT * coeff;
+    return rand() % (MAX_RAIN_HEIGHT * WEATHER_VALUE_SCALE + 1);
 }
 
 /*
  * Get the current wind intensity value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_WindIntensity(void){
+static weather_value_t get_WindIntensity(void){
  
     int MAX_WIND_INTENSITY = 100;
-    float coeff = ((float)rand()/(float)(RAND_MAX));
-
-    return MAX_WIND_INTENSITY * coeff;
+    return rand() % (MAX_WIND_INTENSITY * WEATHER_VALUE_SCALE + 1);
 }
 
 /*
  * Get the current wind direction value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_WindDirection(void){
+static weather_value_t get_WindDirection(void){
 
     int MAX_WIND_DIRECTION = 360;
-    float coeff = ((float)rand()/(float)(RAND_MAX));
+    return rand() % (MAX_WIND_DIRECTION * WEATHER_VALUE_SCALE + 1);
+}
 
-    return MAX_WIND_DIRECTION * coeff;
+/*
+ * Readers of the sensors, by kind of measure, in tenths of the unit
+ */
+static weather_value_t (*const sensorReaders[WEATHER_KIND_NUMOF])(void) = {
+    [WEATHER_KIND_TEMPERATURE] = get_Temperature,
+    [WEATHER_KIND_HUMIDITY] = get_Humidity,
+    [WEATHER_KIND_WIND_DIRECTION] = get_WindDirection,
+    [WEATHER_KIND_WIND_INTENSITY] = get_WindIntensity,
+    [WEATHER_KIND_RAIN] = get_Rain,
+};
+
+static weather_value_t readSensor(const sensor *snr){
+
+    uint32_t start = perf_now();
+    weather_value_t value = sensorReaders[snr->kind]();
+
+    perf_stop(&perfStages[PERF_READ], start);
+    return value;
+}
+
+/*
+ * Print a reading with its decimal, without printf_float
+ */
+static void printValue(const char *what, weather_value_t value, const char *unit){
+
+    char buf[8];
+    payload_t p;
+
+    payload_init(&p, buf, sizeof(buf));
+    payload_append_fixed(&p, value, 1);
+    payload_finish(&p);
+    printf("%s is: %s %s \n", what, buf, unit);
 }
 
 /*
@@ -379,226 +422,274 @@ static int readEnv(int argc,char **argv){
     (void)argv;
 
 
-    printf("Temperature is: %2.6f C \n", get_Temperature());
-    printf("Humidity is: %2.6f perc \n", get_Humidity());
-    printf("WindDirection is: %2.6f degrees \n", get_WindDirection());
-    printf("WindIntensity is: %2.6f m/s \n", get_WindIntensity());
-    printf("Rain height is: %2.6f mm / h \n", get_Rain());
+    printValue("Temperature", get_Temperature(), "C");
+    printValue("Humidity", get_Humidity(), "perc");
+    printValue("WindDirection", get_WindDirection(), "degrees");
+    printValue("WindIntensity", get_WindIntensity(), "m/s");
+    printValue("Rain height", get_Rain(), "mm / h");
 
     return 0;
 }
 
 
 /*
- * Initialize the current board as weather station Charlie
- * Author: Giulio Serra serra.1904089@gmail.com
+ * Make the station at index idx of the registry the one of the board, no
+ * sensor is read
  */
-static void initWeatherStationsInformations(void){
+static void selectStation(unsigned idx){
 
+    const registry_station_t *st = registry_station(idx);
 
-    weatherStation charlie;
-    weatherStation tango;
+    selectedStation.name = st->name;
+    selectedStation.numof = st->numof;
+    for(unsigned k = 0; k < st->numof; k++){
+        const registry_sensor_t *snr = registry_sensor(st->first + k);
+        selectedStation.sensors[k] = (sensor){ snr->ID, 0, snr->sensorName,
+                                               snr->sensorType, snr->kind };
+    }
 
-    charlie.name = "Charlie";
+    currentStation = idx;
+    isStationSelected = true;
+}
 
-    sensor tempC = {"2a92abd7-6d09-11ea-b89f-8f444e8fb0fc",get_Temperature(),"temperatureCharlie","temperaturature"};
-    sensor humC =  {"2a92abd8-6d09-11ea-b89f-8f444e8fb0fc",get_Humidity(),"humidityCharlie","humidity"};
-    sensor wDirC = {"2a92abd9-6d09-11ea-b89f-8f444e8fb0fc",get_WindDirection(),"windDirectionCharlie","WindDirection"};
-    sensor wIntC = {"2a92abda-6d09-11ea-b89f-8f444e8fb0fc",get_WindDirection(),"windIntensityCharlie","WindIntensity"};
-    sensor rainC = {"2a92abdb-6d09-11ea-b89f-8f444e8fb0fc",get_Rain(),"rainHeightCharlie","rain"};
+/*
+ * Print the whole configuration of stations and sensors
+ */
+static int printConfig(int argc,char **argv){
 
-    charlie.sensors[0] = tempC;
-    charlie.sensors[1] = humC;
-    charlie.sensors[2] = wDirC;
-    charlie.sensors[3] = wIntC;
-    charlie.sensors[4] = rainC;
+    (void)argc;
+    (void)argv;
 
+    for(unsigned i = 0; i < registry_stations_numof; i++){
 
-    tango.name = "Tango";
+        printf("Weather station: %s\n\n", registry_stations[i].name);
 
-    sensor tempT = {"2a92abd2-6d09-11ea-b89f-8f444e8fb0fc",get_Temperature(),"temperatureTango","temperaturature"};
-    sensor humT =  {"2a92abd3-6d09-11ea-b89f-8f444e8fb0fc",get_Humidity(),"humidityTango","humidity"};
-    sensor wDirT = {"2a92abd4-6d09-11ea-b89f-8f444e8fb0fc",get_WindDirection(),"windDirectionTango","WindDirection"};
-    sensor wIntT = {"2a92abd5-6d09-11ea-b89f-8f444e8fb0fc",get_WindDirection(),"windIntensityTango","WindIntensity"};
-    sensor rainT = {"2a92abd6-6d09-11ea-b89f-8f444e8fb0fc",get_Rain(),"rainHeightTango","rain"};
+        for(unsigned id = registry_stations[i].first;
+            id < registry_stations[i].first + registry_stations[i].numof; id++){
+            printf("%u %s %s %s\n\n", id, registry_sensors[id].ID,
+                   registry_sensors[id].sensorName, registry_sensors[id].sensorType);
+        }
+    }
 
-    tango.sensors[0] = tempT;
-    tango.sensors[1] = humT;
-    tango.sensors[2] = wDirT;
-    tango.sensors[3] = wIntT;
-    tango.sensors[4] = rainT;
+    return 0;
+}
 
-    stations[0] = charlie;
-    stations[1] = tango;
 
-     /* now print the whole condiguration */
+/**
+*Build a payload that will be used to comunicate over MQTT channel
+* Author: Giulio Serra serra.1904089@gmail.com
+*/
+static int buildPayload(int argc,char **argv){
 
-    for(int i=0; i<2; i++){
+    (void)argc;
+    (void)argv;
 
-        printf("Weather station: %s\n",stations[i].name);
-        printf("%s\n","");
+    if(!isSensorSelected){
+        printf("%s\n", "sensor not initialized, please run the initStation command");
+        return 1;
+    }
 
-        for(int j=0; j<5; j++){
+    char payload[PAYLOAD_JSON_MAXLEN];
+    msgid_t id;
 
-            printf("%s",stations[i].sensors[j].ID);
-            printf("%s"," ");
-            printf("%s",stations[i].sensors[j].sensorName);
-            printf("%s"," ");
-            printf("%s",stations[i].sensors[j].sensorType);
-            printf("%s"," ");
-            printf("%.6f",stations[i].sensors[j].value);
-            printf("%s\n","");
-            printf("%s\n","");
-        }
+    currentSensor.value = readSensor(&currentSensor);
+
+    /* a preview, the ID is left for the next message */
+    msgid_peek(&id);
+    if (payload_sensor_json(payload, sizeof(payload), &currentSensor, &id) < 0) {
+        puts("error: payload does not fit into the buffer");
+        return 1;
     }
-   
-}
 
+    printf("\n%s\n\n", payload);
+
+    return 0;
+}
 
 /**
-* Generate a random string
+* Configure the current sensor type, the sensor is given by name, UUID or
+* compact ID
 * Author: Giulio Serra serra.1904089@gmail.com
 */
-char *randstring(int length) {
-
-    static char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789#?!";        
-    char *randomString = NULL;
+static int initSensor(int argc,char **argv){
 
-    if (length) {
-        randomString = malloc(sizeof(char) * (length +1));
+    if(argc < 3){
+        printf("%s\n", "You should specify <StationName> and <SensorName>");
+        return 0;
+    }
 
-        if (randomString) {            
-            for (int n = 0;n < length;n++) {            
-                int key = rand() % (int)(sizeof(charset) -1);
-                randomString[n] = charset[key];
-            }
+    int st = registry_station_by_name(argv[1]);
+    if(st < 0){
+        printf("WeatherStation %s not found.\n", argv[1]);
+        return 1;
+    }
 
-            randomString[length] = '\0';
-        }
+    int id = registry_sensor_find(argv[2]);
+    if(id < 0 || registry_sensor(id)->station != st){
+        printf("sensor %s not found.\n", argv[2]);
+        return 1;
     }
 
-    return randomString;
+    selectStation(st);
+    currentSlot = id - registry_station(st)->first;
+    currentSensor = selectedStation.sensors[currentSlot];
+    isSensorSelected = true;
+
+    printf("sensor: %s found\n", currentSensor.sensorName);
+    return 0;
 }
 
 
 /**
-*Build a payload that will be used to comunicate over MQTT channel
-* Author: Giulio Serra serra.1904089@gmail.com
+* Configure the current board as a whole weather station
 */
-static int buildPayload(int argc,char **argv){
-
-    (void)argc;
-    (void)argv;
+static int initStation(int argc,char **argv){
 
-    if(!isSensorSelected){
-        printf("%s\n", "sensor not initialized, please run the initStation command");
+    if(argc < 2){
+        printf("%s\n", "You should specify <StationName>");
+        return 1;
     }
-    else{
 
-     
-        char payload[250];
-        strcat(payload, "");
-    
-        char stringifyValue[50];
-        sprintf(stringifyValue , "%.3f", currentSensor.value);
+    int st = registry_station_by_name(argv[1]);
+    if(st < 0){
+        printf("WeatherStation %s not found.\n", argv[1]);
+        return 1;
+    }
 
+    selectStation(st);
+    printf("Weather station: %s found\n",argv[1]);
+    return 0;
+}
 
-        strcat(payload, "{");
-        strcat(payload, "\"sensorName\":");
-        strcat(payload, "\"");
-        strcat(payload,currentSensor.sensorName);
-        strcat(payload,"\",");
-        strcat(payload, "\n");
-        strcat(payload, "\"sensorType\":");
-        strcat(payload, "\"");
-        strcat(payload,currentSensor.sensorType);
-        strcat(payload,"\",");
-        strcat(payload, "\n");
+/**
+* Publish an encoded payload on the given topic, the topic is registered
+* only the first time it is used
+*/
+static int publishNow(const char *topic, const char *payload, size_t len, unsigned flags){
 
-        strcat(payload, "\"origin\":\"physical Device\",");
-        strcat(payload, "\n");
+    emcute_topic_t t;
 
-        strcat(payload, "\"sensorID\":\"");
-        strcat(payload,currentSensor.ID);
-        strcat(payload,"\",");
-        strcat(payload, "\n");
+    LOG_DEBUG("pub with topic: %s and flags 0x%02x\n", topic, (int)flags);
 
-        strcat(payload, "\"value\":");
-        strcat(payload,stringifyValue);
-        strcat(payload,",");
-        strcat(payload, "\n");
+    /* step 1: get topic id */
+    int res = topic_cache_get(&t, topic, &flags);
+    if (res != EMCUTE_OK) {
+        LOG_ERROR("error: unable to obtain topic ID\n");
+        return res;
+    }
 
-        strcat(payload, "\"ID\":\"");
-        strcat(payload,randstring(32));
-        strcat(payload,"\"}");
+    /* step 2: publish data */
+    TRACE("pub", len);
+    uint32_t start = perf_now();
+    res = emcute_pub(&t, payload, len, flags);
+    perf_stop(&perfStages[PERF_PUB], start);
+    if (res == EMCUTE_REJECT && !(flags & EMCUTE_TIT_PREDEF)) {
+        /* the gateway dropped the ID, register the topic again */
+        topic_cache_invalidate(topic);
+        if (topic_cache_get(&t, topic, &flags) == EMCUTE_OK) {
+            start = perf_now();
+            res = emcute_pub(&t, payload, len, flags);
+            perf_stop(&perfStages[PERF_PUB], start);
+        }
+    }
+    TRACE("pub result", res);
+    if (res != EMCUTE_OK) {
+        LOG_ERROR("error: unable to publish data to topic '%s [%i]'\n",
+                  t.name, (int)t.id);
+        return res;
+    }
 
-        printf("%s\n", "");
-        printf("%s\n",payload);
-        printf("%s\n", "");
+    LOG_INFO("Published %i bytes to topic '%s [%i]'\n",
+             (int)len, t.name, t.id);
 
+    return EMCUTE_OK;
+}
 
-        // empty the strings once the payload is printed
-        strcpy(payload, "");
-        strcpy(stringifyValue, "");
-  
-    }
+/**
+* Publications that can succeed later, once a gateway is reachable
+*/
+static bool publishCanRetry(int res){
 
-    return 0;
-    
+    return (res == EMCUTE_NOGW) || (res == EMCUTE_TIMEOUT);
 }
 
 /**
-* Configure the current sensor type
-* Author: Giulio Serra serra.1904089@gmail.com
+* Queue a publication in the outbox, the oldest ones are dropped when full
 */
-static int initSensor(int argc,char **argv){
+static void storePublication(const char *topic, const char *payload, size_t len, unsigned flags){
 
-    (void)argc;
-    (void)argv;
+    size_t topic_len = strlen(topic) + 1;
 
-    if(argc < 3){
-        printf("%s\n", "You should specify <StationName> and <SensorName>");
-        return 0;
+    if (topic_len > TOPIC_MAXLEN || 1 + topic_len + len > sizeof(outboxRecord)) {
+        LOG_ERROR("error: publication too long for the outbox, dropped\n");
+        return;
     }
 
-    initWeatherStationsInformations();
-
-    for(int i=0; i<2; i++){
+    outboxRecord[0] = flags;
+    memcpy(&outboxRecord[1], topic, topic_len);
+    memcpy(&outboxRecord[1 + topic_len], payload, len);
 
-        printf("Weather station: %s\n",stations[i].name);
-        printf("%s\n","");
+    if (outbox_push(&outbox, (uint32_t)(xtimer_now_usec64() / US_PER_SEC),
+                    outboxRecord, 1 + topic_len + len) != 0) {
+        LOG_ERROR("error: publication too long for the outbox, dropped\n");
+        return;
+    }
+    LOG_INFO("publication kept in the outbox, %u waiting\n", outbox_count(&outbox));
+}
 
-        if(strcmp(stations[i].name,argv[1]) == 0){
+/**
+* Publish the publications of the outbox, oldest first, until it is empty or
+* one of them fails again
+*/
+static int replayOutbox(void){
 
-            printf("Weather station: %s found",argv[1]);
-            printf("%s\n","");
+    while(outbox_count(&outbox) > 0){
+        int len = outbox_peek(&outbox, outboxRecord, sizeof(outboxRecord));
+        if (len < 0) {
+            outbox_consume(&outbox, 1);
+            continue;
+        }
 
-            for(int j=0; j<5; j++){
+        const char *topic = &outboxRecord[1];
+        size_t topic_len = strnlen(topic, len - 1) + 1;
+        if (1 + topic_len > (size_t)len) {
+            /* not a record written by storePublication */
+            outbox_consume(&outbox, 1);
+            continue;
+        }
 
-                if(strcmp(stations[i].sensors[j].sensorName,argv[2]) == 0){
+        int res = publishNow(topic, &outboxRecord[1 + topic_len],
+                             len - 1 - topic_len, (uint8_t)outboxRecord[0]);
+        if (publishCanRetry(res)) {
+            return res;
+        }
+        /* sent, or refused for good: either way it is done */
+        outbox_consume(&outbox, 1);
+    }
 
-                    printf("sensor: %s found",argv[2]);
-                    printf("%s\n","");
-                    currentSensor = stations[i].sensors[j];
-                    isSensorSelected = true;
-                    printf("value %f", argv[2]);
-                    return 0;
+    return EMCUTE_OK;
+}
 
+/**
+* Publish an encoded payload after the ones waiting in the outbox, a payload
+* that cannot be published for lack of a gateway waits in the outbox
+*/
+static int publishPayload(const char *topic, const char *payload, size_t len, unsigned flags){
 
-                }
-            }
+    uint32_t start = perf_now();
+    int res = replayOutbox();
 
-            printf("sensor %s not found.\n", argv[2]);
-            return 1;
-        }
-     
+    if (res == EMCUTE_OK) {
+        res = publishNow(topic, payload, len, flags);
+    }
+    if (publishCanRetry(res)) {
+        storePublication(topic, payload, len, flags);
     }
+    perf_stop(&perfStages[PERF_PUBLISH], start);
 
-    printf("WeatherStation %s not found.\n", argv[1]);
-    return 1;
+    return (res == EMCUTE_OK) ? 0 : 1;
 }
 
-
 /**
 * Send the data on mqtt channel from the sensor
 * Author: Giulio Serra serra.1904089@gmail.com
@@ -610,109 +701,283 @@ static int sendPayload(int argc,char **argv){
         return 1;
     }
 
-    emcute_topic_t t;
+    if (argc < 2) {
+        printf("usage: %s <topic name>  [QoS level]\n", argv[0]);
+        return 1;
+    }
+
     unsigned flags = EMCUTE_QOS_0;
 
+    char payload[PAYLOAD_JSON_MAXLEN];
+    msgid_t id;
 
-    char payload[250];
-    time_t mytime = time(NULL);
+    currentSensor.value = readSensor(&currentSensor);
+    uint32_t start = perf_now();
+    msgid_next(&id);
+    int len = payload_sensor_json(payload, sizeof(payload), &currentSensor, &id);
+    perf_stop(&perfStages[PERF_ENCODE], start);
 
-    
-    char payload[250];
-    strcat(payload, "");
-    
-    char stringifyValue[50];
-    sprintf(stringifyValue , "%.3f", currentSensor.value);
+    if (len < 0) {
+        puts("error: payload does not fit into the buffer");
+        return 1;
+    }
 
+    LOG_DEBUG("\n%s\n\n", payload);
 
-    strcat(payload, "{");
-    strcat(payload, "\"sensorName\":");
-    strcat(payload, "\"");
-    strcat(payload,currentSensor.sensorName);
-    strcat(payload,"\",");
-    strcat(payload, "\n");
-    strcat(payload, "\"sensorType\":");
-    strcat(payload, "\"");
-    strcat(payload,currentSensor.sensorType);
-    strcat(payload,"\",");
-    strcat(payload, "\n");
+    /* parse QoS level */
+    if (argc >= 3) {
+        flags |= get_qos(argv[2]);
+    }
 
-    strcat(payload, "\"origin\":\"physical Device\",");
-    strcat(payload, "\n");
+    return publishPayload(argv[1], payload, len, flags);
+}
 
-    strcat(payload, "\"sensorID\":\"");
-    strcat(payload,currentSensor.ID);
-    strcat(payload,"\",");
-    strcat(payload, "\n");
+/**
+* Sample all the sensors of the selected station and publish them in a single
+* message on the mqtt channel
+*/
+static int sendStation(int argc,char **argv){
 
-    strcat(payload, "\"value\":");
-    strcat(payload,stringifyValue);
-    strcat(payload,",");
-    strcat(payload, "\n");
+    if(!isStationSelected){
+        printf("%s\n","You must first initialize the station");
+        return 1;
+    }
 
-    strcat(payload, "\"ID\":\"");
-    strcat(payload,randstring(32));
-    strcat(payload,"\"}");
+    if (argc < 2) {
+        printf("usage: %s <topic name>  [QoS level]\n", argv[0]);
+        return 1;
+    }
 
-    printf("%s\n", "");
-    printf("%s\n",payload);
-    printf("%s\n", "");
+    unsigned flags = EMCUTE_QOS_0;
+    weatherStation *station = &selectedStation;
+    char payload[PAYLOAD_STATION_JSON_MAXLEN];
 
+    for(unsigned k = 0; k < station->numof; k++){
+        station->sensors[k].value = readSensor(&station->sensors[k]);
+    }
 
-    // empty the strings once the payload is printed
-    strcpy(payload, "");
-    strcpy(stringifyValue, "");
-    // empty the strings once the payload is printed
-        
+    msgid_t id;
 
-    if (argc < 2) {
-        printf("usage: %s <topic name>  [QoS level]\n", argv[0]);
+    uint32_t start = perf_now();
+    msgid_next(&id);
+    int len = payload_station_json(payload, sizeof(payload), station, &id);
+    perf_stop(&perfStages[PERF_ENCODE], start);
+
+    if (len < 0) {
+        puts("error: payload does not fit into the buffer");
         return 1;
     }
 
+    LOG_DEBUG("\n%s\n\n", payload);
+
     /* parse QoS level */
     if (argc >= 3) {
-        flags |= get_qos(argv[3]);
+        flags |= get_qos(argv[2]);
     }
 
-    printf("pub with topic: %s and name %s and flags 0x%02x\n", argv[1], payload, (int)flags);
+    return publishPayload(argv[1], payload, len, flags);
+}
+
 
-    /* step 1: get topic id */
-    t.name = argv[1];
-    if (emcute_reg(&t) != EMCUTE_OK) {
-        puts("error: unable to obtain topic ID");
 
-        strcpy(payload, ""); 
-        strcpy(stringifyTime, "");
-        strcpy(stringifyValue, "");
 
+static void _outbox_usage(void)
+{
+    puts("Usage: outbox <status|flush|clear>");
+}
+
+/**
+* Show the publications waiting for the gateway, replay them now or forget
+* them
+*/
+static int outboxCmd(int argc,char **argv){
+
+    if(argc < 2){
+        _outbox_usage();
+        return 1;
+    }
+
+    if(strcmp(argv[1], "status") == 0){
+        printf("%u publications waiting (%u bytes), queued %" PRIu32
+               ", replayed %" PRIu32 ", dropped %" PRIu32 "\n",
+               outbox_count(&outbox), outbox.used, outbox.queued,
+               outbox.replayed, outbox.dropped);
+    }
+    else if(strcmp(argv[1], "flush") == 0){
+        if(replayOutbox() != EMCUTE_OK){
+            printf("%u publications still waiting\n", outbox_count(&outbox));
+            return 1;
+        }
+    }
+    else if(strcmp(argv[1], "clear") == 0){
+        outbox_clear(&outbox);
+    }
+    else{
+        _outbox_usage();
         return 1;
     }
 
-    /* step 2: publish data */
-    if (emcute_pub(&t, payload, strlen(payload), flags) != EMCUTE_OK) {
+    return 0;
+}
 
-        strcpy(payload, ""); 
-        strcpy(stringifyTime, "");
-        strcpy(stringifyValue, "");
+/*
+ * Completion of a pipelined publication, called by the publisher thread
+ */
+static void pubqDone(int res, void *arg){
+
+    (void)arg;
 
-        printf("error: unable to publish data to topic '%s [%i]'\n",
-                t.name, (int)t.id);
+    TRACE("pubq result", res);
+    if(res != 0){
+        LOG_WARNING("pipelined publication failed (%d)\n", res);
+    }
+}
+
+static void _pubq_usage(void)
+{
+    puts("Usage: pubq <con <ipv6 addr> [port]|discon|stats|"
+         "send <topic> <count> [QoS level]>");
+}
+
+/**
+* Pipelined publisher: queue many station payloads at once, up to
+* PUBQ_WINDOW of them wait for their acknowledgment at the same time
+*/
+static int pubqCmd(int argc,char **argv){
+
+    if(argc < 2){
+        _pubq_usage();
+        return 1;
+    }
+
+    if(strcmp(argv[1], "con") == 0){
+        sock_udp_ep_t gw = { .family = AF_INET6, .port = EMCUTE_PORT };
+        char id[24];
+
+        if(argc < 3 || ipv6_addr_from_str((ipv6_addr_t *)&gw.addr.ipv6, argv[2]) == NULL){
+            _pubq_usage();
+            return 1;
+        }
+        if(argc >= 4){
+            gw.port = atoi(argv[3]);
+        }
+
+        /* the session is a second client next to emcute */
+        snprintf(id, sizeof(id), "%s-pub", EMCUTE_ID);
+        int res = pubq_con(&gw, PUBQ_PORT, id);
+        if(res != 0){
+            printf("error: unable to connect to [%s]:%i (%d)\n", argv[2], (int)gw.port, res);
+            return 1;
+        }
+        printf("Pipelined publisher connected as %s\n", id);
+    }
+    else if(strcmp(argv[1], "discon") == 0){
+        pubq_discon();
+    }
+    else if(strcmp(argv[1], "stats") == 0){
+        pubq_stats_t st;
+
+        pubq_get_stats(&st);
+        printf("queued %" PRIu32 ", delivered %" PRIu32 ", failed %" PRIu32
+               ", retransmissions %" PRIu32 ", in flight %u, waiting %u\n",
+               st.queued, st.delivered, st.failed, st.retransmissions,
+               st.in_flight, st.waiting);
+    }
+    else if(strcmp(argv[1], "send") == 0){
+        if(argc < 4){
+            _pubq_usage();
+            return 1;
+        }
+        if(!isStationSelected){
+            printf("%s\n","You must first initialize the station");
+            return 1;
+        }
+
+        unsigned count = strtoul(argv[3], NULL, 0);
+        unsigned flags = (argc >= 5) ? get_qos(argv[4]) : EMCUTE_QOS_1;
+        weatherStation *station = &selectedStation;
+        char payload[PAYLOAD_STATION_JSON_MAXLEN];
+        uint32_t start = xtimer_now_usec();
+
+        for(unsigned i = 0; i < count; i++){
+            for(unsigned k = 0; k < station->numof; k++){
+                station->sensors[k].value = readSensor(&station->sensors[k]);
+            }
+
+            msgid_t id;
+
+            msgid_next(&id);
+            int len = payload_station_json(payload, sizeof(payload), station, &id);
+            if(len < 0){
+                puts("error: payload does not fit into the buffer");
+                return 1;
+            }
+
+            int res;
+            /* the queue is full: wait for the window to move */
+            while((res = pubq_pub(argv[2], payload, len, flags, pubqDone, NULL)) == -ENOBUFS){
+                xtimer_usleep(10U * US_PER_MS);
+            }
+            if(res != 0){
+                printf("error: unable to queue publication %u (%d)\n", i, res);
+                return 1;
+            }
+        }
+
+        printf("%u publications queued in %" PRIu32 " ms\n", count,
+               (xtimer_now_usec() - start) / US_PER_MS);
+    }
+    else{
+        _pubq_usage();
         return 1;
     }
 
-    printf("Published %i bytes to topic '%s [%i]'\n",
-            (int)strlen(payload), t.name, t.id);
+    return 0;
+}
+
+/**
+* Print the time spent in the stages of the publication pipeline, "perf reset"
+* prints and starts over
+*/
+static int perfCmd(int argc,char **argv){
+
+    bool reset = (argc >= 2 && strcmp(argv[1], "reset") == 0);
+
+    if(argc >= 2 && !reset){
+        printf("usage: %s [reset]\n", argv[0]);
+        return 1;
+    }
 
-    strcpy(payload, ""); 
-    strcpy(stringifyTime, "");
-    strcpy(stringifyValue, "");
+    for(unsigned i = 0; i < PERF_NUMOF; i++){
+        perf_print(&perfStages[i]);
+        if(reset){
+            perf_reset(&perfStages[i]);
+        }
+    }
 
     return 0;
 }
 
+#ifdef WEATHER_TRACE
+/**
+* Print the events recorded by the trace, or forget them
+*/
+static int traceCmd(int argc,char **argv){
 
+    if(argc < 2){
+        trace_print();
+    }
+    else if(strcmp(argv[1], "clear") == 0){
+        trace_clear();
+    }
+    else{
+        printf("usage: %s [clear]\n", argv[0]);
+        return 1;
+    }
 
+    return 0;
+}
+#endif
 
 /*------------------------------------------------------------------------------------------------------------------*/
 
@@ -730,7 +995,19 @@ static const shell_command_t shell_commands[] = {
     { "readEnv","print all the values from all the sensors on the board",readEnv},
     { "printPay", "show a payload for the current sensor on the board to upload on MQTT", buildPayload },
     { "initSensor", "init the current board as a sensor of a weather station", initSensor},
+    { "printConfig", "print the stations and sensors known to the board", printConfig},
     {"sendPayload","send the data over MQTT channel",sendPayload},
+    { "initStation", "init the current board as a whole weather station", initStation},
+    {"sendStation","send the readings of all the station sensors in one MQTT message",sendStation},
+    {"pubq","pipelined publisher for draining many messages",pubqCmd},
+    {"outbox","show, replay or clear the publications waiting for the gateway",outboxCmd},
+    {"perf","print the time spent in the publication stages, reset starts over",perfCmd},
+#ifdef WEATHER_TRACE
+    {"trace","print the recorded publication events",traceCmd},
+#endif
+#ifdef LOADGEN
+    {"loadgen","simulate many stations publishing to a MQTT-SN gateway",loadgen_cmd},
+#endif
     { NULL, NULL, NULL }
 };
 
@@ -743,9 +1020,22 @@ int main(void)
     /* the main thread needs a msg queue to be able to run `ping6`*/
     msg_init_queue(queue, (sizeof(queue) / sizeof(msg_t)));
 
+    if (registry_init() != 0) {
+        puts("Invalid station topology");
+    }
+
+    /* no EEPROM on this board, the boot epoch is the time of boot */
+    msgid_init(EMCUTE_ID, (uint32_t)time(NULL));
+
+    outbox_init(&outbox);
+    perf_init();
+
     /* initialize our subscription buffers */
     memset(subscriptions, 0, (NUMOFSUBS * sizeof(emcute_sub_t)));
 
+    /* start the pipelined publisher, idle until pubq con */
+    pubq_init(PUBQ_PRIO);
+
     /* start the emcute thread */
     thread_create(stack, sizeof(stack), EMCUTE_PRIO, 0,
                   emcute_thread, NULL, "emcute");
@@ -0,0 +1,53 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Encoding of the MQTT-SN v1.2 messages not handled by emcute
+ */
+
+#include "mqttsn.h"
+
+size_t mqttsn_header(uint8_t *buf, size_t len, uint8_t type)
+{
+    if (len + 2 <= UINT8_MAX) {
+        buf[0] = len + 2;
+        buf[1] = type;
+        return 2;
+    }
+    buf[0] = 0x01;
+    mqttsn_put_u16(&buf[1], len + 4);
+    buf[3] = type;
+    return 4;
+}
+
+int mqttsn_parse(const uint8_t *buf, size_t len, uint8_t *type,
+                 const uint8_t **body)
+{
+    size_t msg_len, hdr_len;
+
+    if (len < 2) {
+        return -1;
+    }
+    if (buf[0] == 0x01) {
+        if (len < 4) {
+            return -1;
+        }
+        msg_len = mqttsn_get_u16(&buf[1]);
+        hdr_len = 4;
+    }
+    else {
+        msg_len = buf[0];
+        hdr_len = 2;
+    }
+    if (msg_len < hdr_len || msg_len > len) {
+        return -1;
+    }
+
+    *type = buf[hdr_len - 1];
+    *body = &buf[hdr_len];
+    return msg_len - hdr_len;
+}
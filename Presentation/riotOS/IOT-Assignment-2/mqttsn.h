@@ -0,0 +1,107 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Encoding of the MQTT-SN v1.2 messages not handled by emcute
+ *
+ * Used where the one request at a time client of emcute is not enough: the
+ * load generator and the pipelined publisher.
+ */
+
+#ifndef MQTTSN_H
+#define MQTTSN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name    Message types
+ * @{
+ */
+#define MQTTSN_CONNECT          (0x04)
+#define MQTTSN_CONNACK          (0x05)
+#define MQTTSN_REGISTER         (0x0a)
+#define MQTTSN_REGACK           (0x0b)
+#define MQTTSN_PUBLISH          (0x0c)
+#define MQTTSN_PUBACK           (0x0d)
+#define MQTTSN_PUBCOMP          (0x0e)
+#define MQTTSN_PUBREC           (0x0f)
+#define MQTTSN_PUBREL           (0x10)
+#define MQTTSN_PINGREQ          (0x16)
+#define MQTTSN_PINGRESP         (0x17)
+#define MQTTSN_DISCONNECT       (0x18)
+/** @} */
+
+/**
+ * @name    Flags, protocol ID and return code
+ * @{
+ */
+#define MQTTSN_FLAG_DUP         (0x80)
+#define MQTTSN_FLAG_QOS_MASK    (0x60)
+#define MQTTSN_FLAG_QOS1        (0x20)
+#define MQTTSN_FLAG_QOS2        (0x40)
+#define MQTTSN_FLAG_CS          (0x04)
+#define MQTTSN_PROTOCOL_ID      (0x01)
+#define MQTTSN_ACCEPTED         (0x00)
+/** @} */
+
+/**
+ * @brief   Length of the longest header
+ */
+#define MQTTSN_HEADER_MAXLEN    (4U)
+
+/**
+ * @brief   Write the header of a message
+ *
+ * @param[out] buf      destination, at least MQTTSN_HEADER_MAXLEN bytes
+ * @param[in]  len      length of the message body
+ * @param[in]  type     message type
+ *
+ * @return  length of the header, the body follows it
+ */
+size_t mqttsn_header(uint8_t *buf, size_t len, uint8_t type);
+
+/**
+ * @brief   Parse the header of a received message
+ *
+ * @param[in]  buf      message
+ * @param[in]  len      length of @p buf
+ * @param[out] body     body of the message
+ *
+ * @return  length of the body
+ * @return  -1 if the message is truncated or malformed, @p type is then
+ *          not set
+ */
+int mqttsn_parse(const uint8_t *buf, size_t len, uint8_t *type,
+                 const uint8_t **body);
+
+/**
+ * @brief   Write a 16-bit big endian field
+ */
+static inline void mqttsn_put_u16(uint8_t *buf, uint16_t val)
+{
+    buf[0] = val >> 8;
+    buf[1] = val & 0xff;
+}
+
+/**
+ * @brief   Read a 16-bit big endian field
+ */
+static inline uint16_t mqttsn_get_u16(const uint8_t *buf)
+{
+    return (buf[0] << 8) | buf[1];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MQTTSN_H */
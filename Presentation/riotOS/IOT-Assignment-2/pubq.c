@@ -0,0 +1,597 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Pipelined MQTT-SN publisher
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "mqttsn.h"
+#include "pubq.h"
+#include "topic_cache.h"
+
+/* longest wait of the thread for a message, so retransmissions and the end
+ * of the session are handled in time */
+#define PUBQ_POLL_US            (100U * US_PER_MS)
+#define PUBQ_KEEPALIVE_S        (900U)
+/* a PINGREQ goes out after half the keepalive period without any message to
+ * the gateway, so the gateway never drops an idle session */
+#define PUBQ_PING_US            (PUBQ_KEEPALIVE_S / 2 * US_PER_SEC)
+#define PUBQ_ID_MAXLEN          (23U)
+#define PUBQ_TIT_PREDEF         (0x01)
+#define PUBQ_RC_INVALID_TOPIC   (0x02)
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,        /* waiting for the window */
+    SLOT_WAIT_ACK,      /* PUBLISH sent, waiting for PUBACK or PUBREC */
+    SLOT_WAIT_COMP,     /* PUBREL sent, waiting for PUBCOMP */
+    SLOT_DONE,          /* completed, waiting for its callback */
+} _slot_state_t;
+
+typedef struct {
+    uint8_t msg[PUBQ_MSG_MAXLEN];   /* PUBLISH message, ready to be sent */
+    uint32_t order;                 /* queueing order */
+    uint32_t sent_at;
+    pubq_cb_t cb;
+    void *arg;
+    int res;                        /* outcome, once completed */
+    uint16_t len;
+    uint16_t msg_id;
+    uint16_t topic_id;
+    uint8_t flags_pos;              /* position of the flags in msg */
+    uint8_t state;
+    uint8_t qos;
+    uint8_t tries;
+} _slot_t;
+
+typedef struct {
+    pubq_cb_t cb;
+    void *arg;
+    int res;
+} _done_t;
+
+typedef struct {
+    char name[TOPIC_CACHE_NAME_MAXLEN];
+    uint16_t id;
+    bool used;
+} _topic_t;
+
+static char _stack[THREAD_STACKSIZE_DEFAULT];
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static mutex_t _lock = MUTEX_INIT;
+
+/* everything below is protected by _lock */
+static sock_udp_t _sock;
+static bool _connected;
+static bool _closing;
+static _slot_t _slots[PUBQ_QUEUE_SIZE];
+static _topic_t _topics[PUBQ_TOPICS];
+static unsigned _topic_next;
+static uint32_t _order;
+static uint16_t _msg_id;
+static pubq_stats_t _stats;
+static uint32_t _last_tx;       /* last message sent to the gateway */
+static uint32_t _ping_sent;
+static unsigned _ping_tries;    /* PINGREQ sent without a PINGRESP */
+
+/* topic registration, the caller waits on _reg_done that the thread
+ * releases when the REGACK arrives */
+static mutex_t _reg_done = MUTEX_INIT_LOCKED;
+static struct {
+    bool waiting;
+    uint16_t msg_id;
+    uint16_t topic_id;
+    uint8_t rc;
+} _reg;
+
+static uint16_t _next_msg_id(void)
+{
+    if (++_msg_id == 0) {
+        _msg_id = 1;
+    }
+    return _msg_id;
+}
+
+static void _complete(_slot_t *slot, int res)
+{
+    if (res == 0) {
+        _stats.delivered++;
+    }
+    else {
+        _stats.failed++;
+    }
+    /* the slot stays taken until the callback ran, so the completions
+     * waiting for the thread never outnumber the slots */
+    slot->res = res;
+    slot->state = slot->cb ? SLOT_DONE : SLOT_FREE;
+}
+
+/* run the callbacks of the completed publications, outside of _lock */
+static void _notify(void)
+{
+    _done_t done[PUBQ_QUEUE_SIZE];
+    unsigned numof = 0;
+
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        _slot_t *slot = &_slots[i];
+        if (slot->state == SLOT_DONE) {
+            done[numof++] = (_done_t){ slot->cb, slot->arg, slot->res };
+            slot->state = SLOT_FREE;
+        }
+    }
+    mutex_unlock(&_lock);
+
+    for (unsigned i = 0; i < numof; i++) {
+        done[i].cb(done[i].res, done[i].arg);
+    }
+}
+
+static int _send(const void *buf, size_t len)
+{
+    _last_tx = xtimer_now_usec();
+    return sock_udp_send(&_sock, buf, len, NULL);
+}
+
+static void _send_pubrel(uint16_t msg_id)
+{
+    uint8_t buf[4];
+    size_t pos = mqttsn_header(buf, 2, MQTTSN_PUBREL);
+
+    mqttsn_put_u16(&buf[pos], msg_id);
+    _send(buf, pos + 2);
+}
+
+static void _transmit(_slot_t *slot, uint32_t now)
+{
+    int res = _send(slot->msg, slot->len);
+
+    if (slot->qos == 0) {
+        _complete(slot, (res < 0) ? res : 0);
+        return;
+    }
+
+    /* a failed send is retried like a lost message */
+    slot->state = SLOT_WAIT_ACK;
+    slot->sent_at = now;
+    slot->tries++;
+}
+
+static unsigned _in_flight(void)
+{
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        if (_slots[i].state == SLOT_WAIT_ACK || _slots[i].state == SLOT_WAIT_COMP) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/* send the oldest queued publications while the window has room */
+static void _fill_window(uint32_t now)
+{
+    unsigned in_flight = _in_flight();
+
+    while (in_flight < PUBQ_WINDOW) {
+        _slot_t *next = NULL;
+
+        for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+            if (_slots[i].state == SLOT_QUEUED &&
+                (next == NULL || (int32_t)(_slots[i].order - next->order) < 0)) {
+                next = &_slots[i];
+            }
+        }
+        if (next == NULL) {
+            return;
+        }
+        _transmit(next, now);
+        if (next->qos) {
+            in_flight++;
+        }
+    }
+}
+
+static void _retransmit(uint32_t now)
+{
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        _slot_t *slot = &_slots[i];
+
+        if ((slot->state != SLOT_WAIT_ACK && slot->state != SLOT_WAIT_COMP) ||
+            (now - slot->sent_at) < PUBQ_RETRY_US) {
+            continue;
+        }
+        if (slot->tries >= PUBQ_TRIES) {
+            _complete(slot, -ETIMEDOUT);
+            continue;
+        }
+
+        _stats.retransmissions++;
+        slot->tries++;
+        slot->sent_at = now;
+        if (slot->state == SLOT_WAIT_ACK) {
+            slot->msg[slot->flags_pos] |= MQTTSN_FLAG_DUP;
+            _send(slot->msg, slot->len);
+        }
+        else {
+            _send_pubrel(slot->msg_id);
+        }
+    }
+}
+
+/* keep the session alive, a gateway that answers no PINGREQ is gone and the
+ * session is closed, so the publications fail now instead of timing out */
+static void _keepalive(uint32_t now)
+{
+    uint8_t buf[2];
+
+    if (_ping_tries == 0) {
+        if ((now - _last_tx) < PUBQ_PING_US) {
+            return;
+        }
+    }
+    else if ((now - _ping_sent) < PUBQ_RETRY_US) {
+        return;
+    }
+    else if (_ping_tries >= PUBQ_TRIES) {
+        _closing = true;
+        return;
+    }
+
+    mqttsn_header(buf, 0, MQTTSN_PINGREQ);
+    _send(buf, sizeof(buf));
+    _ping_sent = now;
+    _ping_tries++;
+}
+
+static _slot_t *_find(uint16_t msg_id, _slot_state_t state)
+{
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        if (_slots[i].state == state && _slots[i].msg_id == msg_id) {
+            return &_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void _forget_topic(uint16_t topic_id)
+{
+    for (unsigned i = 0; i < PUBQ_TOPICS; i++) {
+        if (_topics[i].used && _topics[i].id == topic_id) {
+            _topics[i].used = false;
+        }
+    }
+}
+
+static void _handle(const uint8_t *buf, size_t len, uint32_t now)
+{
+    const uint8_t *body;
+    uint8_t type;
+    int body_len = mqttsn_parse(buf, len, &type, &body);
+    _slot_t *slot;
+
+    if (body_len < 0) {
+        return;
+    }
+
+    switch (type) {
+        case MQTTSN_PUBACK:
+            if (body_len >= 5 &&
+                (slot = _find(mqttsn_get_u16(&body[2]), SLOT_WAIT_ACK))) {
+                if (body[4] == PUBQ_RC_INVALID_TOPIC) {
+                    _forget_topic(slot->topic_id);
+                }
+                _complete(slot, (body[4] == MQTTSN_ACCEPTED) ? 0 : -ECONNREFUSED);
+            }
+            break;
+        case MQTTSN_PUBREC:
+            if (body_len < 2) {
+                break;
+            }
+            /* answer a repeated PUBREC too, our PUBREL may be lost */
+            if ((slot = _find(mqttsn_get_u16(&body[0]), SLOT_WAIT_ACK)) ||
+                (slot = _find(mqttsn_get_u16(&body[0]), SLOT_WAIT_COMP))) {
+                if (slot->state == SLOT_WAIT_ACK) {
+                    slot->state = SLOT_WAIT_COMP;
+                    slot->tries = 1;
+                }
+                slot->sent_at = now;
+                _send_pubrel(slot->msg_id);
+            }
+            break;
+        case MQTTSN_PUBCOMP:
+            if (body_len >= 2 &&
+                (slot = _find(mqttsn_get_u16(&body[0]), SLOT_WAIT_COMP))) {
+                _complete(slot, 0);
+            }
+            break;
+        case MQTTSN_REGACK:
+            if (body_len >= 5 && _reg.waiting &&
+                mqttsn_get_u16(&body[2]) == _reg.msg_id) {
+                _reg.topic_id = mqttsn_get_u16(&body[0]);
+                _reg.rc = body[4];
+                _reg.waiting = false;
+                mutex_unlock(&_reg_done);
+            }
+            break;
+        case MQTTSN_PINGRESP:
+            _ping_tries = 0;
+            break;
+        case MQTTSN_DISCONNECT:
+            /* the gateway dropped the session */
+            _closing = true;
+            break;
+        default:
+            break;
+    }
+}
+
+static void _close(void)
+{
+    uint8_t buf[2];
+
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        if (_slots[i].state != SLOT_FREE && _slots[i].state != SLOT_DONE) {
+            _complete(&_slots[i], -ENOTCONN);
+        }
+    }
+
+    mqttsn_header(buf, 0, MQTTSN_DISCONNECT);
+    _send(buf, sizeof(buf));
+    sock_udp_close(&_sock);
+    _connected = false;
+    _closing = false;
+}
+
+static void *_pubq_thread(void *arg)
+{
+    (void)arg;
+    static uint8_t buf[64];
+
+    while (1) {
+        if (!_connected) {
+            /* woken up by pubq_con() */
+            msg_t m;
+            msg_receive(&m);
+            continue;
+        }
+
+        ssize_t len = sock_udp_recv(&_sock, buf, sizeof(buf), PUBQ_POLL_US, NULL);
+        uint32_t now = xtimer_now_usec();
+
+        mutex_lock(&_lock);
+        if (len > 0) {
+            _handle(buf, len, now);
+        }
+        _retransmit(now);
+        _fill_window(now);
+        _keepalive(now);
+        if (_closing) {
+            _close();
+        }
+        mutex_unlock(&_lock);
+
+        _notify();
+    }
+
+    return NULL;
+}
+
+void pubq_init(uint8_t prio)
+{
+    _pid = thread_create(_stack, sizeof(_stack), prio, 0,
+                         _pubq_thread, NULL, "pubq");
+}
+
+int pubq_con(const sock_udp_ep_t *gw, uint16_t local_port, const char *client_id)
+{
+    sock_udp_ep_t local = SOCK_IPV6_EP_ANY;
+    uint8_t buf[MQTTSN_HEADER_MAXLEN + 4 + PUBQ_ID_MAXLEN];
+    size_t id_len = strnlen(client_id, PUBQ_ID_MAXLEN);
+    int res;
+
+    if (_connected) {
+        return -EALREADY;
+    }
+
+    local.port = local_port;
+    res = sock_udp_create(&_sock, &local, gw, 0);
+    if (res < 0) {
+        return res;
+    }
+
+    size_t pos = mqttsn_header(buf, 4 + id_len, MQTTSN_CONNECT);
+    buf[pos++] = MQTTSN_FLAG_CS;
+    buf[pos++] = MQTTSN_PROTOCOL_ID;
+    mqttsn_put_u16(&buf[pos], PUBQ_KEEPALIVE_S);
+    pos += 2;
+    memcpy(&buf[pos], client_id, id_len);
+
+    /* the thread is not receiving yet, wait for the CONNACK here */
+    res = -ETIMEDOUT;
+    for (unsigned tries = 0; tries < PUBQ_TRIES && res == -ETIMEDOUT; tries++) {
+        uint8_t rx[8];
+        const uint8_t *body;
+        uint8_t type;
+
+        sock_udp_send(&_sock, buf, pos + id_len, NULL);
+
+        ssize_t len = sock_udp_recv(&_sock, rx, sizeof(rx), PUBQ_RETRY_US, NULL);
+        if (len > 0 && mqttsn_parse(rx, len, &type, &body) >= 1 &&
+            type == MQTTSN_CONNACK) {
+            res = (body[0] == MQTTSN_ACCEPTED) ? 0 : -ECONNREFUSED;
+        }
+    }
+    if (res != 0) {
+        sock_udp_close(&_sock);
+        return res;
+    }
+
+    mutex_lock(&_lock);
+    memset(_topics, 0, sizeof(_topics));
+    memset(&_stats, 0, sizeof(_stats));
+    _last_tx = xtimer_now_usec();
+    _ping_tries = 0;
+    _connected = true;
+    mutex_unlock(&_lock);
+
+    msg_t m = { .type = 0 };
+    msg_send(&m, _pid);
+    return 0;
+}
+
+void pubq_discon(void)
+{
+    mutex_lock(&_lock);
+    if (_connected) {
+        _closing = true;
+    }
+    mutex_unlock(&_lock);
+}
+
+/* find the ID of a topic, called with _lock held, released while waiting
+ * for the gateway, so only one thread may publish */
+static int _topic_id(const char *name, uint16_t *id, uint8_t *tit)
+{
+    int predef = topic_cache_predefined(name);
+
+    if (predef >= 0) {
+        *id = predef;
+        *tit = PUBQ_TIT_PREDEF;
+        return 0;
+    }
+
+    *tit = 0;
+    for (unsigned i = 0; i < PUBQ_TOPICS; i++) {
+        if (_topics[i].used && strcmp(_topics[i].name, name) == 0) {
+            *id = _topics[i].id;
+            return 0;
+        }
+    }
+
+    size_t name_len = strlen(name);
+    uint8_t buf[MQTTSN_HEADER_MAXLEN + 4 + TOPIC_CACHE_NAME_MAXLEN];
+    if (name_len >= TOPIC_CACHE_NAME_MAXLEN) {
+        return -EMSGSIZE;
+    }
+
+    size_t pos = mqttsn_header(buf, 4 + name_len, MQTTSN_REGISTER);
+    _reg.msg_id = _next_msg_id();
+    _reg.waiting = true;
+    mqttsn_put_u16(&buf[pos], 0);
+    mqttsn_put_u16(&buf[pos + 2], _reg.msg_id);
+    memcpy(&buf[pos + 4], name, name_len);
+    _send(buf, pos + 4 + name_len);
+
+    mutex_unlock(&_lock);
+    int res = xtimer_mutex_lock_timeout(&_reg_done, PUBQ_RETRY_US);
+    mutex_lock(&_lock);
+
+    if (!_connected || _closing) {
+        return -ENOTCONN;
+    }
+    if (res != 0) {
+        _reg.waiting = false;
+        /* consume a REGACK that arrived in between */
+        mutex_trylock(&_reg_done);
+        return -ETIMEDOUT;
+    }
+    if (_reg.rc != MQTTSN_ACCEPTED) {
+        return -ECONNREFUSED;
+    }
+
+    _topic_t *t = &_topics[_topic_next++ % PUBQ_TOPICS];
+    memcpy(t->name, name, name_len + 1);
+    t->id = _reg.topic_id;
+    t->used = true;
+    *id = t->id;
+    return 0;
+}
+
+int pubq_pub(const char *topic, const void *data, size_t len, unsigned flags,
+             pubq_cb_t cb, void *arg)
+{
+    _slot_t *slot = NULL;
+    uint16_t topic_id;
+    uint8_t tit;
+    int res;
+
+    if (len + MQTTSN_HEADER_MAXLEN + 5 > PUBQ_MSG_MAXLEN) {
+        return -EMSGSIZE;
+    }
+
+    mutex_lock(&_lock);
+
+    if (!_connected || _closing) {
+        mutex_unlock(&_lock);
+        return -ENOTCONN;
+    }
+
+    res = _topic_id(topic, &topic_id, &tit);
+    if (res != 0) {
+        mutex_unlock(&_lock);
+        return res;
+    }
+
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        if (_slots[i].state == SLOT_FREE) {
+            slot = &_slots[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        mutex_unlock(&_lock);
+        return -ENOBUFS;
+    }
+
+    slot->qos = (flags & MQTTSN_FLAG_QOS_MASK) >> 5;
+    slot->msg_id = slot->qos ? _next_msg_id() : 0;
+    slot->topic_id = topic_id;
+    slot->flags_pos = mqttsn_header(slot->msg, 5 + len, MQTTSN_PUBLISH);
+    slot->msg[slot->flags_pos] = (flags & MQTTSN_FLAG_QOS_MASK) | tit;
+    mqttsn_put_u16(&slot->msg[slot->flags_pos + 1], topic_id);
+    mqttsn_put_u16(&slot->msg[slot->flags_pos + 3], slot->msg_id);
+    memcpy(&slot->msg[slot->flags_pos + 5], data, len);
+    slot->len = slot->flags_pos + 5 + len;
+    slot->cb = cb;
+    slot->arg = arg;
+    slot->tries = 0;
+    slot->order = _order++;
+    slot->state = SLOT_QUEUED;
+    _stats.queued++;
+
+    /* send right away when the window has room, a QoS 0 publication is
+     * reported by the thread on its next poll */
+    _fill_window(xtimer_now_usec());
+
+    mutex_unlock(&_lock);
+    return 0;
+}
+
+void pubq_get_stats(pubq_stats_t *stats)
+{
+    mutex_lock(&_lock);
+    *stats = _stats;
+    stats->in_flight = _in_flight();
+    stats->waiting = 0;
+    for (unsigned i = 0; i < PUBQ_QUEUE_SIZE; i++) {
+        if (_slots[i].state == SLOT_QUEUED) {
+            stats->waiting++;
+        }
+    }
+    mutex_unlock(&_lock);
+}
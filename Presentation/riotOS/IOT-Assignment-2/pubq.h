@@ -0,0 +1,164 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Pipelined MQTT-SN publisher
+ *
+ * emcute waits for the acknowledgment of a publication before the next one
+ * can be sent, capping a node at one QoS 1 message per round trip to the
+ * gateway. The publisher runs its own MQTT-SN session next to emcute: the
+ * publications are queued, up to PUBQ_WINDOW of them wait for their
+ * acknowledgment at the same time, and the ones not acknowledged in time
+ * are sent again with the DUP flag. The result of every publication is
+ * reported through its callback, run by the publisher thread. A publication
+ * takes one of the PUBQ_QUEUE_SIZE slots until its callback ran.
+ *
+ * An idle session is kept alive with PINGREQ messages. When the gateway
+ * answers none of them, the session is closed and the publications fail
+ * with -ENOTCONN instead of each timing out.
+ */
+
+#ifndef PUBQ_H
+#define PUBQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "timex.h"
+#include "net/sock/udp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Publications waiting for their acknowledgment at the same time
+ */
+#ifndef PUBQ_WINDOW
+#define PUBQ_WINDOW             (4U)
+#endif
+
+/**
+ * @brief   Publications queued, including the ones in flight
+ */
+#ifndef PUBQ_QUEUE_SIZE
+#define PUBQ_QUEUE_SIZE         (16U)
+#endif
+
+/**
+ * @brief   Maximum length of a PUBLISH message, header included
+ */
+#ifndef PUBQ_MSG_MAXLEN
+#define PUBQ_MSG_MAXLEN         (512U)
+#endif
+
+/**
+ * @brief   Time to wait for an acknowledgment before sending again
+ */
+#ifndef PUBQ_RETRY_US
+#define PUBQ_RETRY_US           (2U * US_PER_SEC)
+#endif
+
+/**
+ * @brief   Transmissions of a message before giving up
+ */
+#ifndef PUBQ_TRIES
+#define PUBQ_TRIES              (3U)
+#endif
+
+/**
+ * @brief   Registered topic IDs kept by the session
+ */
+#ifndef PUBQ_TOPICS
+#define PUBQ_TOPICS             (4U)
+#endif
+
+/**
+ * @brief   Completion of a publication
+ *
+ * Called from the publisher thread, also for QoS 0 publications, must not
+ * block.
+ *
+ * @param[in]  res      0 if delivered, -ETIMEDOUT if not acknowledged,
+ *                      -ECONNREFUSED if rejected by the gateway,
+ *                      -ENOTCONN if the session was closed
+ * @param[in]  arg      argument given to pubq_pub()
+ */
+typedef void (*pubq_cb_t)(int res, void *arg);
+
+/**
+ * @brief   Counters of the session
+ */
+typedef struct {
+    uint32_t queued;            /**< publications accepted */
+    uint32_t delivered;         /**< publications acknowledged, or sent at QoS 0 */
+    uint32_t failed;            /**< publications given up */
+    uint32_t retransmissions;   /**< messages sent again */
+    unsigned in_flight;         /**< publications waiting for acknowledgment */
+    unsigned waiting;           /**< publications waiting for the window */
+} pubq_stats_t;
+
+/**
+ * @brief   Start the publisher thread
+ *
+ * @param[in]  prio     priority of the thread
+ */
+void pubq_init(uint8_t prio);
+
+/**
+ * @brief   Open the session with a gateway
+ *
+ * @param[in]  gw           address of the gateway
+ * @param[in]  local_port   local UDP port, must differ from the one of emcute
+ * @param[in]  client_id    client ID, must differ from the one of emcute
+ *
+ * @return  0 on success
+ * @return  -EALREADY if a session is open
+ * @return  -ETIMEDOUT if the gateway did not answer
+ * @return  -ECONNREFUSED if the gateway refused the connection
+ * @return  a negative errno from the socket otherwise
+ */
+int pubq_con(const sock_udp_ep_t *gw, uint16_t local_port, const char *client_id);
+
+/**
+ * @brief   Close the session, the publications not completed fail
+ */
+void pubq_discon(void);
+
+/**
+ * @brief   Queue a publication
+ *
+ * The data is copied. A topic that is neither predefined nor known to the
+ * session is registered first, blocking the caller until the gateway
+ * answers, publications must then come from a single thread.
+ *
+ * @param[in]  topic    topic name
+ * @param[in]  data     payload
+ * @param[in]  len      length of @p data
+ * @param[in]  flags    EMCUTE_QOS_0, EMCUTE_QOS_1 or EMCUTE_QOS_2
+ * @param[in]  cb       completion callback, may be NULL
+ * @param[in]  arg      argument of @p cb
+ *
+ * @return  0 if queued
+ * @return  -ENOTCONN if no session is open
+ * @return  -ENOBUFS if the queue is full
+ * @return  -EMSGSIZE if @p len is too large
+ * @return  -ETIMEDOUT or -ECONNREFUSED if the topic could not be registered
+ */
+int pubq_pub(const char *topic, const void *data, size_t len, unsigned flags,
+             pubq_cb_t cb, void *arg);
+
+/**
+ * @brief   Get the counters of the session
+ */
+void pubq_get_stats(pubq_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PUBQ_H */
@@ -0,0 +1,116 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Cache of the MQTT-SN topic IDs
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "topic_cache.h"
+
+typedef struct {
+    const char *name;
+    uint16_t id;
+} _predef_t;
+
+/* topics predefined on the gateway, see predefinedTopic.conf */
+static const _predef_t _predefined[] = {
+#define PREDEFINED_TOPIC(name, id)  { name, id },
+#include "topics.def"
+#undef PREDEFINED_TOPIC
+};
+
+typedef struct {
+    char name[TOPIC_CACHE_NAME_MAXLEN];
+    uint32_t used;              /* value of _clock at the last use, 0 if free */
+    uint16_t id;
+} _entry_t;
+
+static _entry_t _cache[TOPIC_CACHE_SIZE];
+static uint32_t _clock;
+
+static _entry_t *_find(const char *name)
+{
+    for (unsigned i = 0; i < TOPIC_CACHE_SIZE; i++) {
+        if (_cache[i].used && strcmp(_cache[i].name, name) == 0) {
+            return &_cache[i];
+        }
+    }
+    return NULL;
+}
+
+static _entry_t *_victim(void)
+{
+    _entry_t *lru = &_cache[0];
+
+    for (unsigned i = 1; i < TOPIC_CACHE_SIZE; i++) {
+        if (_cache[i].used < lru->used) {
+            lru = &_cache[i];
+        }
+    }
+    return lru;
+}
+
+int topic_cache_predefined(const char *name)
+{
+    for (unsigned i = 0; i < sizeof(_predefined) / sizeof(_predefined[0]); i++) {
+        if (strcmp(_predefined[i].name, name) == 0) {
+            return _predefined[i].id;
+        }
+    }
+    return -1;
+}
+
+int topic_cache_get(emcute_topic_t *topic, const char *name, unsigned *flags)
+{
+    int predef = topic_cache_predefined(name);
+
+    topic->name = name;
+
+    if (predef >= 0) {
+        topic->id = predef;
+        *flags |= EMCUTE_TIT_PREDEF;
+        return EMCUTE_OK;
+    }
+
+    _entry_t *e = _find(name);
+    if (e) {
+        e->used = ++_clock;
+        topic->id = e->id;
+        return EMCUTE_OK;
+    }
+
+    int res = emcute_reg(topic);
+    if (res != EMCUTE_OK) {
+        return res;
+    }
+
+    if (strlen(name) < TOPIC_CACHE_NAME_MAXLEN) {
+        e = _victim();
+        strcpy(e->name, name);
+        e->id = topic->id;
+        e->used = ++_clock;
+    }
+    return EMCUTE_OK;
+}
+
+void topic_cache_invalidate(const char *name)
+{
+    _entry_t *e = _find(name);
+
+    if (e) {
+        e->used = 0;
+    }
+}
+
+void topic_cache_reset(void)
+{
+    memset(_cache, 0, sizeof(_cache));
+    _clock = 0;
+}
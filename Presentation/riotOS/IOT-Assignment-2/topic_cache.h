@@ -0,0 +1,77 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Cache of the MQTT-SN topic IDs
+ *
+ * A topic name is registered with the gateway the first time it is used,
+ * its ID is then kept until the client reconnects or the gateway rejects
+ * it. Topics predefined on the gateway, listed in topics.def, are never
+ * registered.
+ */
+
+#ifndef TOPIC_CACHE_H
+#define TOPIC_CACHE_H
+
+#include "net/emcute.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Number of registered topic IDs kept, the least recently used one
+ *          is replaced when the cache is full
+ */
+#ifndef TOPIC_CACHE_SIZE
+#define TOPIC_CACHE_SIZE        (8U)
+#endif
+
+/**
+ * @brief   Maximum length of a cached topic name, including the terminating
+ *          zero, longer names are registered every time
+ */
+#ifndef TOPIC_CACHE_NAME_MAXLEN
+#define TOPIC_CACHE_NAME_MAXLEN (64U)
+#endif
+
+/**
+ * @brief   Get the ID of a topic, registering it if it is not known yet
+ *
+ * @param[out] topic    topic, name and ID
+ * @param[in]  name     topic name, must stay valid while @p topic is used
+ * @param[out] flags    the topic ID type is added to the publish flags
+ *
+ * @return  EMCUTE_OK on success
+ * @return  the error of emcute_reg() otherwise
+ */
+int topic_cache_get(emcute_topic_t *topic, const char *name, unsigned *flags);
+
+/**
+ * @brief   Get the ID of a topic predefined on the gateway
+ *
+ * @return  the topic ID
+ * @return  -1 if @p name is not a predefined topic
+ */
+int topic_cache_predefined(const char *name);
+
+/**
+ * @brief   Forget the ID of a topic, e.g. after the gateway rejected it
+ */
+void topic_cache_invalidate(const char *name);
+
+/**
+ * @brief   Forget all the registered IDs, they are only valid for the
+ *          connection they were registered on
+ */
+void topic_cache_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOPIC_CACHE_H */
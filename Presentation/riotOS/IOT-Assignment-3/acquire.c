@@ -0,0 +1,258 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       HTS221 acquisition thread
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+#include "thread.h"
+#include "thread_flags.h"
+#include "xtimer.h"
+#include "periph/i2c.h"
+
+#include "trace.h"
+
+#include "acquire.h"
+
+#define FLAG_DRDY           (0x0001)
+
+/* CTRL_REG3 of the HTS221, DRDY_EN drives the DRDY pin high on new data */
+#define HTS221_CTRL_REG3    (0x22)
+#define HTS221_DRDY_EN      (0x04)
+
+static hts221_t *_dev;
+static sampleq_t *_queue;
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static volatile bool _drdy;         /* woken by data ready */
+static uint32_t _slack;             /* half the output data interval, in ms */
+
+/* requested by the shell, applied by the thread */
+static volatile uint32_t _period = ACQUIRE_PERIOD_DEFAULT;
+static volatile bool _low_power;
+static bool _one_shot;
+
+/* written by the thread only */
+static volatile weather_value_t _temperature;
+static volatile weather_value_t _humidity;
+static volatile bool _valid;
+static volatile unsigned _failed;
+
+#ifdef MODULE_PERIPH_GPIO_IRQ
+static void _ready(void *arg)
+{
+    (void)arg;
+    thread_flags_set(thread_get(_pid), FLAG_DRDY);
+}
+
+/* route data ready to the DRDY pin */
+static int _enable_drdy(const hts221_t *dev)
+{
+    i2c_acquire(dev->p.i2c);
+    int res = i2c_write_reg(dev->p.i2c, dev->p.addr, HTS221_CTRL_REG3,
+                            HTS221_DRDY_EN, 0);
+    i2c_release(dev->p.i2c);
+    return res;
+}
+#endif
+
+static uint32_t _now_ms(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+}
+
+static void _apply_mode(void)
+{
+    bool low = _low_power;
+
+    if (low == _one_shot) {
+        return;
+    }
+    if (low) {
+        hts221_set_rate(_dev, HTS221_REGVAL_ODR_ONE_SHOT);
+        hts221_power_off(_dev);
+    }
+    else {
+        hts221_power_on(_dev);
+        hts221_set_rate(_dev, _dev->p.rate);
+    }
+    _one_shot = low;
+}
+
+static void _push(uint32_t time, weather_kind_t kind, weather_value_t value)
+{
+    sampleq_entry_t e = { time, kind, value };
+
+    if (!sampleq_push(_queue, &e)) {
+        TRACE("sample dropped", kind);
+    }
+}
+
+/* read both measures, which also clears data ready, and queue them if kept */
+static void _sample(uint32_t time, bool keep)
+{
+    int16_t temp;
+    uint16_t hum;
+
+    if (_one_shot) {
+        hts221_power_on(_dev);
+        hts221_one_shot(_dev);
+        xtimer_usleep(ACQUIRE_ONE_SHOT_WAIT_US);
+    }
+    int temp_res = hts221_read_temperature(_dev, &temp);
+    int hum_res = hts221_read_humidity(_dev, &hum);
+    if (_one_shot) {
+        hts221_power_off(_dev);
+    }
+
+    if (temp_res != HTS221_OK || hum_res != HTS221_OK) {
+        _failed++;
+        return;
+    }
+
+    _temperature = temp;
+    _humidity = hum;
+    _valid = true;
+    if (keep) {
+        _push(time, WEATHER_KIND_TEMPERATURE, temp);
+        _push(time, WEATHER_KIND_HUMIDITY, hum);
+    }
+}
+
+static void *_thread(void *arg)
+{
+    (void)arg;
+    uint64_t last = xtimer_now_usec64();
+    xtimer_t timeout;
+    uint32_t next = _now_ms();
+
+    while (1) {
+        _apply_mode();
+
+        if (!_drdy || _one_shot) {
+            /* in 64 bit, a period of an uplink interval (hours) does not fit
+             * the 32 bit microseconds of xtimer_periodic_wakeup */
+            uint64_t now = xtimer_now_usec64();
+            last += (uint64_t)_period * US_PER_MS;
+            if (last > now) {
+                xtimer_usleep64(last - now);
+            }
+            else {
+                /* late, the schedule restarts from now without a burst */
+                last = now;
+            }
+            _sample(_now_ms(), true);
+            continue;
+        }
+
+        /* the timeout catches a lost edge and a change of mode */
+        xtimer_set_timeout_flag(&timeout, ACQUIRE_DRDY_TIMEOUT_US);
+        thread_flags_wait_any(FLAG_DRDY | THREAD_FLAG_TIMEOUT);
+        xtimer_remove(&timeout);
+        thread_flags_clear(FLAG_DRDY | THREAD_FLAG_TIMEOUT);
+        last = xtimer_now_usec64();
+
+        /* keep the conversion closest to the schedule, which does not drift
+         * with the clock of the sensor */
+        uint32_t now = _now_ms();
+        bool keep = (int32_t)(now + _slack - next) >= 0;
+        _sample(now, keep);
+        if (keep) {
+            next += _period;
+            if ((int32_t)(now - next) >= 0) {
+                next = now + _period;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int acquire_init(char *stack, int stacksize, uint8_t prio, hts221_t *dev,
+                 sampleq_t *q, gpio_t drdy)
+{
+    _dev = dev;
+    _queue = q;
+    _one_shot = false;
+    _low_power = false;
+
+    switch (dev->p.rate) {
+    case HTS221_REGVAL_ODR_7HZ:
+        _slack = MS_PER_SEC / 14;
+        break;
+    case HTS221_REGVAL_ODR_12HZ:
+        _slack = MS_PER_SEC / 25;
+        break;
+    default:
+        _slack = MS_PER_SEC / 2;
+        break;
+    }
+
+#ifdef MODULE_PERIPH_GPIO_IRQ
+    _drdy = (drdy != GPIO_UNDEF) && (_enable_drdy(dev) == 0);
+#else
+    (void)drdy;
+    _drdy = false;
+#endif
+
+    _pid = thread_create(stack, stacksize, prio, THREAD_CREATE_STACKTEST,
+                         _thread, NULL, "acquire");
+    if (_pid <= KERNEL_PID_UNDEF) {
+        return -ENOMEM;
+    }
+
+#ifdef MODULE_PERIPH_GPIO_IRQ
+    /* without the interrupt the timeouts would pace the thread */
+    if (_drdy && gpio_init_int(drdy, GPIO_IN, GPIO_RISING, _ready, NULL) != 0) {
+        _drdy = false;
+    }
+#endif
+
+    return _pid;
+}
+
+bool acquire_is_running(void)
+{
+    return _pid > KERNEL_PID_UNDEF;
+}
+
+bool acquire_provides(weather_kind_t kind)
+{
+    return acquire_is_running() &&
+           (kind == WEATHER_KIND_TEMPERATURE || kind == WEATHER_KIND_HUMIDITY);
+}
+
+void acquire_set_period(uint32_t period)
+{
+    _period = period ? period : 1;
+}
+
+void acquire_set_low_power(bool on)
+{
+    _low_power = on;
+}
+
+bool acquire_latest(weather_kind_t kind, weather_value_t *value)
+{
+    if (!acquire_provides(kind) || !_valid) {
+        return false;
+    }
+    *value = (kind == WEATHER_KIND_TEMPERATURE) ? _temperature : _humidity;
+    return true;
+}
+
+unsigned acquire_failed(void)
+{
+    return _failed;
+}
+
+bool acquire_uses_drdy(void)
+{
+    return _drdy;
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       HTS221 acquisition thread
+ *
+ * The temperature and the humidity are read by a thread of their own, at a
+ * priority above the telemetry, so a sample is never late because of a LoRa
+ * transmission and the I2C bus is only used by this thread. The thread is
+ * woken by the data ready output of the HTS221 when it is wired to a GPIO
+ * with interrupts, else by a periodic timer, and pushes every sample with the
+ * time of its conversion into a sample queue, see sampleq.h, which the
+ * telemetry drains. The shell gets the latest samples without touching the
+ * bus.
+ *
+ * The data ready output follows the output data rate of the sensor, the
+ * samples are thinned out to the acquisition period. In low power mode the
+ * sensor is off between samples and the timer starts a one-shot conversion.
+ */
+
+#ifndef ACQUIRE_H
+#define ACQUIRE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hts221.h"
+#include "timex.h"
+#include "periph/gpio.h"
+
+#include "sampleq.h"
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Default time between two samples, in milliseconds
+ */
+#ifndef ACQUIRE_PERIOD_DEFAULT
+#define ACQUIRE_PERIOD_DEFAULT      (10U * MS_PER_SEC)
+#endif
+
+/**
+ * @brief   Time the HTS221 needs to complete a one-shot conversion
+ */
+#ifndef ACQUIRE_ONE_SHOT_WAIT_US
+#define ACQUIRE_ONE_SHOT_WAIT_US    (40U * US_PER_MS)
+#endif
+
+/**
+ * @brief   Longest wait for a data ready edge before the sensor is read anyway
+ */
+#ifndef ACQUIRE_DRDY_TIMEOUT_US
+#define ACQUIRE_DRDY_TIMEOUT_US     (2U * US_PER_SEC)
+#endif
+
+/**
+ * @brief   Start the acquisition thread
+ *
+ * The sensor must be initialized, powered on and in continuous mode.
+ *
+ * @param[in]  stack        stack of the thread
+ * @param[in]  stacksize    size of @p stack
+ * @param[in]  prio         priority of the thread, above the consumer of @p q
+ * @param[in]  dev          sensor, only used by the thread from now on
+ * @param[in]  q            queue of the samples, the thread is its producer
+ * @param[in]  drdy         GPIO of the data ready output, GPIO_UNDEF to use
+ *                          the timer
+ *
+ * @return  PID of the thread
+ * @return  negative errno if the thread could not be created
+ */
+int acquire_init(char *stack, int stacksize, uint8_t prio, hts221_t *dev,
+                 sampleq_t *q, gpio_t drdy);
+
+/**
+ * @brief   Check whether the acquisition thread is running
+ */
+bool acquire_is_running(void);
+
+/**
+ * @brief   Check whether the thread samples a kind of measure
+ */
+bool acquire_provides(weather_kind_t kind);
+
+/**
+ * @brief   Set the time between two samples, from the next one on
+ *
+ * @param[in]  period   period in milliseconds, at least 1
+ */
+void acquire_set_period(uint32_t period);
+
+/**
+ * @brief   Switch the sensor between continuous and one-shot conversions
+ *
+ * The thread applies the change before its next sample.
+ */
+void acquire_set_low_power(bool on);
+
+/**
+ * @brief   Get the latest sample of a kind of measure
+ *
+ * @return  true on success
+ * @return  false if the thread does not sample @p kind or has no sample yet
+ */
+bool acquire_latest(weather_kind_t kind, weather_value_t *value);
+
+/**
+ * @brief   Number of failed reads of the sensor
+ */
+unsigned acquire_failed(void);
+
+/**
+ * @brief   Check whether the data ready interrupt wakes the thread
+ */
+bool acquire_uses_drdy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACQUIRE_H */
@@ -25,7 +25,9 @@
 #include <string.h>
 #include <inttypes.h>
 #include "xtimer.h"
+#include "mutex.h"
 
+#include "log.h"
 #include "msg.h"
 #include "shell.h"
 #include "fmt.h"
@@ -36,38 +38,140 @@
 #include "hts221.h"
 #include "hts221_params.h"
 
+#ifdef MODULE_PM_LAYERED
+#include "periph_cpu.h"
+#include "pm_layered.h"
+#endif
+
+#include "weather.h"
+#include "payload.h"
+#include "tsbuf.h"
+#include "aggr.h"
+#include "deadband.h"
+#include "wind.h"
+#include "rain.h"
+#include "sampleq.h"
+#include "telemetry.h"
+#include "energy.h"
+#include "registry.h"
+#include "outbox.h"
+#include "txplan.h"
+#include "msgid.h"
+#include "trace.h"
+#include "perf.h"
+
+#include "acquire.h"
+
 semtech_loramac_t loramac;
 static hts221_t dev;
 
 static bool isSensorSelected = false;
 static bool isSensorInitialized = true; /*Detect if temperature and humidity sensors are initialized*/
-static int MINUTES_BEFORE_RETRASMISSION = 1;
+static bool lowPower = false;           /* sensor in one-shot mode, MCU allowed into LOWPOWER_PM_MODE */
+
+/* The xtimer of the b-l072z-lrwan1 runs on TIM2, which is not clocked in
+ * STOP: the telemetry and acquisition timers would never fire and nothing
+ * would wake the MCU. Without LOWPOWER_PM_MODE the MCU waits in sleep, which
+ * keeps the timers running. Define it (e.g. to STM32_PM_STOP) only when the
+ * timers run from a clock that keeps going in that mode, like the LPTIM */
+#ifdef LOWPOWER_PM_MODE
+#define LOWPOWER_ENERGY_STATE       ENERGY_STATE_STOP
+#else
+#define LOWPOWER_ENERGY_STATE       ENERGY_STATE_IDLE
+#endif
 
-/**
-*Struct declaration that rappresent all the five sensors mounted on the board(weather station)
-*/
-typedef struct 
-{
-  char *ID;
-  float value;
-  char *sensorName;
-  char *sensorType;
+static int MINUTES_BEFORE_RETRASMISSION = 1;
+static int SECONDS_BETWEEN_SAMPLES = 10;
 
-}sensor; 
+#ifndef UPLINK_ENCODING_DEFAULT
+#define UPLINK_ENCODING_DEFAULT     PAYLOAD_ENCODING_BINARY
+#endif
 
-/**
-*Struct declaration thta rappresents the station
-*/
-typedef struct station{
-    sensor sensors[5];
-    char *name;
-}weatherStation;
+static payload_encoding_t uplinkEncoding = UPLINK_ENCODING_DEFAULT;
 
-static weatherStation stations[2];
+static weatherStation selectedStation; /* the selected station, values are the latest readings */
 static sensor currentSensor;
+static uint8_t currentSensorIndex;  /* compact ID of the selected sensor, used by the binary frames */
+static unsigned currentSlot;        /* position of the selected sensor in its station */
+static bool isStationSelected = false;
+static uint8_t currentStation;      /* registry index of the selected station */
+
+/* guards the selected station and the windows, buffers and deadbands of its
+   sensors, shared by the shell and the telemetry thread, taken before loraLock */
+static mutex_t stationLock = MUTEX_INIT;
+
+/* readings of the station sensors waiting for an uplink, by sensor position */
+static tsbuf_t sensorSeries[WEATHER_SENSORS_NUMOF];
+
+/* summary of the readings of the station sensors in the current window, which
+   the uplink closes, by sensor position */
+static aggr_t sensorWindows[WEATHER_SENSORS_NUMOF];
+
+/* telemetry uplinks carry the summary of the window, not the raw readings */
+static bool summaryUplinks = true;
+
+/* report-by-exception policy of the station sensors, by sensor position */
+static deadband_t sensorBands[WEATHER_SENSORS_NUMOF];
+
+/* positions of the wind direction and speed sensors of the selected station,
+   WEATHER_SENSORS_NUMOF if it lacks one. With summary uplinks both are
+   sampled by the slot of the direction into one wind vector window */
+static unsigned windDirectionSlot = WEATHER_SENSORS_NUMOF;
+static unsigned windSpeedSlot = WEATHER_SENSORS_NUMOF;
+static wind_t windWindow;
+
+/* sampling and uplink periods of the station sensors, by sensor position */
+static telemetry_slot_t telemetrySlots[WEATHER_SENSORS_NUMOF];
+static char telemetryStack[THREAD_STACKSIZE_DEFAULT + 512];
+
+/* payloads encoded by the telemetry thread, only it uses this buffer so it
+   is kept out of its stack */
+static uint8_t telemetryPayload[PAYLOAD_STATION_JSON_MAXLEN];
+
+/* HTS221 samples taken by the acquisition thread, drained by the telemetry */
+static sampleq_t acquiredSamples;
+static char acquireStack[THREAD_STACKSIZE_DEFAULT];
+
+#ifndef HTS221_DRDY_PIN
+#define HTS221_DRDY_PIN             GPIO_UNDEF
+#endif
+
+/* stages of the telemetry pipeline timed for the perf command */
+enum {
+    PERF_READ,      /* sensor reads and samples of the acquisition thread */
+    PERF_ENCODE,    /* JSON documents and binary frames */
+    PERF_SEND,      /* semtech_loramac_send */
+    PERF_UPLINK,    /* whole uplink: outbox, MAC lock and send */
+    PERF_NUMOF,
+};
+
+static perf_stage_t perfStages[PERF_NUMOF] = {
+    [PERF_READ] = PERF_STAGE_INIT("read"),
+    [PERF_ENCODE] = PERF_STAGE_INIT("encode"),
+    [PERF_SEND] = PERF_STAGE_INIT("send"),
+    [PERF_UPLINK] = PERF_STAGE_INIT("uplink"),
+};
+
+/* the shell and the telemetry thread both send over the MAC */
+static mutex_t loraLock = MUTEX_INIT;
+
+/* largest application payload accepted by the MAC at the highest EU868 data rate */
+#define LORAMAC_MAX_PAYLOAD_LEN     (222U)
+
+/* uplinks refused by the MAC, replayed once the link is back */
+static outbox_t outbox;
+
+/* frames replayed from the outbox, used with loraLock held */
+static uint8_t outboxBatch[LORAMAC_MAX_PAYLOAD_LEN];
+
+/* data rate, duty cycle and backlog aware choice of the uplink parameters */
+static txplan_t txPlan;
 
 
 
+/* DevEUI in hex, node ID of the message IDs */
+static char nodeId[LORAMAC_DEVEUI_LEN * 2 + 1];
+
 /* Application key is 16 bytes long (e.g. 32 hex chars), and thus the longest
    possible size (with application session and network session keys) */
 static char print_buf[LORAMAC_APPKEY_LEN * 2 + 1];
@@ -547,25 +651,19 @@ static int _cmd_loramac(int argc, char **argv)
  * Get the current temperaturature value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_Temperature(void){
+static weather_value_t get_Temperature(void){
 
     if(!isSensorInitialized){
 
         int MAX_TEMP = 100;
-        float coeff = ((float)rand()/(float)(RAND_MAX));
-        return MAX_TEMP * coeff;
+        return rand() % (MAX_TEMP * WEATHER_VALUE_SCALE + 1);
 
     }else{
 
-        int16_t temp = 0;
-
-        if (hts221_read_temperature(&dev, &temp) != HTS221_OK) {
-            puts("failed to read hts221 temperature");
-        }
-
-        printf("original temperature %d \n",temp);
-
-        return (float)(temp/10);
+        /* the latest sample of the acquisition thread, the bus is not used */
+        weather_value_t temp = 0;
+        acquire_latest(WEATHER_KIND_TEMPERATURE, &temp);
+        return temp;
     }
   
 }
@@ -574,26 +672,18 @@ static float get_Temperature(void){
  * Get the current humidity value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_Humidity(void){
+static weather_value_t get_Humidity(void){
 
     if(!isSensorInitialized){
         int MAX_HUMIDITY = 100;
-        float coeff = ((float)rand()/(float)(RAND_MAX));
-        return MAX_HUMIDITY * coeff;
+        return rand() % (MAX_HUMIDITY * WEATHER_VALUE_SCALE + 1);
     }
     else{
 
-        uint16_t hum = 0;
-
-        if (hts221_read_humidity(&dev, &hum) != HTS221_OK) {
-            puts("failed to read hts221 humidity");
-        }
-
-
-        printf("original humidity %d \n",hum);
-
-        return (float)(hum/10);
-
+        /* the latest sample of the acquisition thread, the bus is not used */
+        weather_value_t hum = 0;
+        acquire_latest(WEATHER_KIND_HUMIDITY, &hum);
+        return hum;
     }
    
    
@@ -603,128 +693,216 @@ static float get_Humidity(void){
  * Get the current rain height value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_Rain(void){
+static weather_value_t get_Rain(void){
 
-    int MAX_RAIN_HEIGHT = 50;
-    float coeff = ((float)rand()/(float)(RAND_MAX));
+    /* the gauge gives the mean intensity since its last report */
+    if(rain_is_active()){
+        rain_report_t rain;
+        rain_peek(&rain);
+        return rain.intensity;
+    }
 
-    return MAX_RAIN_HEIGHT * coeff;
+    int MAX_RAIN_HEIGHT = 50;
+    return rand() % (MAX_RAIN_HEIGHT * WEATHER_VALUE_SCALE + 1);
 }
 
 /*
  * Get the current wind intensity value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_WindIntensity(void){
+static weather_value_t get_WindIntensity(void){
  
     int MAX_WIND_INTENSITY = 100;
-    float coeff = ((float)rand()/(float)(RAND_MAX));
-
-    return MAX_WIND_INTENSITY * coeff;
+    return rand() % (MAX_WIND_INTENSITY * WEATHER_VALUE_SCALE + 1);
 }
 
 /*
  * Get the current wind direction value detected by the device
  * Author: Giulio Serra serra.1904089@gmail.com
  */
-static float get_WindDirection(void){
+static weather_value_t get_WindDirection(void){
 
     int MAX_WIND_DIRECTION = 360;
-    float coeff = ((float)rand()/(float)(RAND_MAX));
+    return rand() % (MAX_WIND_DIRECTION * WEATHER_VALUE_SCALE + 1);
+}
 
-    return MAX_WIND_DIRECTION * coeff;
+
+/*
+ * Readers of the sensors, by kind of measure, in tenths of the unit
+ */
+static weather_value_t (*const sensorReaders[WEATHER_KIND_NUMOF])(void) = {
+    [WEATHER_KIND_TEMPERATURE] = get_Temperature,
+    [WEATHER_KIND_HUMIDITY] = get_Humidity,
+    [WEATHER_KIND_WIND_DIRECTION] = get_WindDirection,
+    [WEATHER_KIND_WIND_INTENSITY] = get_WindIntensity,
+    [WEATHER_KIND_RAIN] = get_Rain,
+};
+
+static weather_value_t readSensor(const sensor *snr){
+
+    uint32_t start = perf_now();
+    weather_value_t value = sensorReaders[snr->kind]();
+
+    perf_stop(&perfStages[PERF_READ], start);
+    return value;
 }
 
 
 /*
- * Initialize the current board as weather station Charlie
- * Author: Giulio Serra serra.1904089@gmail.com
+ * Pace the acquisition thread on the shortest sampling period of the sensors
+ * it samples, or on their uplink period when they are not sampled
  */
-static void initWeatherStationsInformations(void){
+static void syncAcquisition(void){
 
+    uint32_t period = 0;
+
+    for(unsigned k = 0; k < selectedStation.numof; k++){
+        uint32_t sample_s, uplink_s;
+
+        if(!acquire_provides(selectedStation.sensors[k].kind)){
+            continue;
+        }
+        telemetry_get_periods(k, &sample_s, &uplink_s);
+        if(sample_s == 0){
+            sample_s = uplink_s;
+        }
+        if(sample_s && (period == 0 || sample_s < period)){
+            period = sample_s;
+        }
+    }
+
+    if(period){
+        acquire_set_period(period * MS_PER_SEC);
+    }
+}
 
-    weatherStation charlie;
-    weatherStation tango;
+/*
+ * Make the station at index idx of the registry the one of the board, no
+ * sensor is read. stationLock must be held
+ */
+static void selectStation(unsigned idx){
 
-    charlie.name = "Charlie";
+    const registry_station_t *st = registry_station(idx);
 
-    sensor tempC = {"2c107530-743b-11ea-9072-737364a53ef5",get_Temperature(),"temperatureCharlie","temperature"};
-    sensor humC =  {"2c107531-743b-11ea-9072-737364a53ef5",get_Humidity(),"humidityCharlie","humidity"};
-    sensor wDirC = {"2c107532-743b-11ea-9072-737364a53ef5",get_WindDirection(),"windDirectionCharlie","WindDirection"};
-    sensor wIntC = {"2c107533-743b-11ea-9072-737364a53ef5",get_WindIntensity(),"windIntensityCharlie","WindIntensity"};
-    sensor rainC = {"2c107534-743b-11ea-9072-737364a53ef5",get_Rain(),"rainHeightCharlie","rain"};
+    selectedStation.name = st->name;
+    selectedStation.numof = st->numof;
+    for(unsigned k = 0; k < st->numof; k++){
+        const registry_sensor_t *snr = registry_sensor(st->first + k);
+        selectedStation.sensors[k] = (sensor){ snr->ID, 0, snr->sensorName,
+                                               snr->sensorType, snr->kind };
+    }
 
-    charlie.sensors[0] = tempC;
-    charlie.sensors[1] = humC;
-    charlie.sensors[2] = wDirC;
-    charlie.sensors[3] = wIntC;
-    charlie.sensors[4] = rainC;
+    windDirectionSlot = WEATHER_SENSORS_NUMOF;
+    windSpeedSlot = WEATHER_SENSORS_NUMOF;
+    for(unsigned k = st->numof; k-- > 0;){
+        if(selectedStation.sensors[k].kind == WEATHER_KIND_WIND_DIRECTION){
+            windDirectionSlot = k;
+        }
+        else if(selectedStation.sensors[k].kind == WEATHER_KIND_WIND_INTENSITY){
+            windSpeedSlot = k;
+        }
+    }
 
-    tango.name = "Tango";
+    /* slots past the sensors of the station have nothing to sample */
+    for(unsigned k = st->numof; k < WEATHER_SENSORS_NUMOF; k++){
+        telemetry_set_periods(k, 0, 0);
+    }
 
-    sensor tempT = {"2c107535-743b-11ea-9072-737364a53ef5",get_Temperature(),"temperatureTango","temperature"};
-    sensor humT =  {"2c107536-743b-11ea-9072-737364a53ef5",get_Humidity(),"humidityTango","humidity"};
-    sensor wDirT = {"2c107537-743b-11ea-9072-737364a53ef5",get_WindDirection(),"windDirectionTango","WindDirection"};
-    sensor wIntT = {"2c107538-743b-11ea-9072-737364a53ef5",get_WindIntensity(),"windIntensityTango","WindIntensity"};
-    sensor rainT = {"2c107539-743b-11ea-9072-737364a53ef5",get_Rain(),"rainHeightTango","rain"};
+    /* the policies follow the kind of the sensors, the ones set by hand are
+       kept while the station stays the same */
+    if(!isStationSelected || currentStation != idx){
+        for(unsigned k = 0; k < st->numof; k++){
+            deadband_cfg_t cfg;
+            deadband_default(&cfg, selectedStation.sensors[k].kind);
+            deadband_init(&sensorBands[k], &cfg);
+        }
+    }
 
-    tango.sensors[0] = tempT;
-    tango.sensors[1] = humT;
-    tango.sensors[2] = wDirT;
-    tango.sensors[3] = wIntT;
-    tango.sensors[4] = rainT;
+    /* the buffered readings belong to the sensors of the previous station */
+    if(isStationSelected && currentStation != idx){
+        for(unsigned k = 0; k < WEATHER_SENSORS_NUMOF; k++){
+            tsbuf_init(&sensorSeries[k]);
+            aggr_init(&sensorWindows[k]);
+        }
+        wind_init(&windWindow);
+    }
 
-    stations[0] = charlie;
-    stations[1] = tango;
+    currentStation = idx;
+    isStationSelected = true;
+}
 
-     /* now print the whole condiguration */
+/*
+ * Print the whole configuration of stations and sensors
+ */
+static int printConfig(int argc,char **argv){
 
-    for(int i=0; i<2; i++){
+    (void)argc;
+    (void)argv;
 
-        printf("Weather station: %s\n",stations[i].name);
-        printf("%s\n","");
+    for(unsigned i = 0; i < registry_stations_numof; i++){
 
-        for(int j=0; j<5; j++){
+        printf("Weather station: %s\n\n", registry_stations[i].name);
 
-            printf("%s",stations[i].sensors[j].ID);
-            printf("%s"," ");
-            printf("%s",stations[i].sensors[j].sensorName);
-            printf("%s"," ");
-            printf("%s",stations[i].sensors[j].sensorType);
-            printf("%s"," ");
-            printf("%f",stations[i].sensors[j].value);
-            printf("%s\n","");
-            printf("%s\n","");
+        for(unsigned id = registry_stations[i].first;
+            id < registry_stations[i].first + registry_stations[i].numof; id++){
+            printf("%u %s %s %s\n\n", id, registry_sensors[id].ID,
+                   registry_sensors[id].sensorName, registry_sensors[id].sensorType);
         }
     }
+
+    return 0;
 }
 
 
 /**
-* Generate a random string
-* Author: Giulio Serra serra.1904089@gmail.com
+* Encode the current reading of the selected sensor with the uplink encoding,
+* binary frames carry the low 16 bits of the message counter
 */
-char *randstring(int length) {
+static int encodeCurrentSensor(uint8_t *buf, size_t size, const msgid_t *id){
 
-    static char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789#?!";        
-    char *randomString = NULL;
+    currentSensor.value = readSensor(&currentSensor);
 
-    if (length) {
-        randomString = malloc(sizeof(char) * (length +1));
+    uint32_t start = perf_now();
+    int len;
 
-        if (randomString) {            
-            for (int n = 0;n < length;n++) {            
-                int key = rand() % (int)(sizeof(charset) -1);
-                randomString[n] = charset[key];
-            }
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        len = payload_reading_frame(buf, size, currentSensorIndex,
+                                    currentSensor.value, id->seq);
+    }
+    else{
+        len = payload_sensor_json((char *)buf, size, &currentSensor, id);
+    }
+
+    perf_stop(&perfStages[PERF_ENCODE], start);
+    return len;
+}
+
+/**
+* Print an encoded payload, binary frames are dumped in hex
+*/
+static void printEncoded(const uint8_t *buf, int len){
 
-            randomString[length] = '\0';
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        printf("%s\n","");
+        for(int i = 0; i < len; i++){
+            printf("%02x", buf[i]);
         }
+        printf(" (%d bytes)\n\n", len);
+    }
+    else{
+        printf("\n%s\n\n", (const char *)buf);
     }
-
-    return randomString;
 }
 
+/**
+* Print a payload about to be sent, compiled out below LOG_DEBUG
+*/
+static void logEncoded(const uint8_t *buf, int len){
+
+    if(LOG_LEVEL >= LOG_DEBUG){
+        printEncoded(buf, len);
+    }
+}
 
 /**
 *Build a payload that will be used to comunicate over MQTT channel
@@ -737,270 +915,1348 @@ static int buildPayload(int argc,char **argv){
 
     if(!isSensorSelected){
         printf("%s\n", "sensor not initialized, please run the initStation command");
+        return 1;
     }
-    else{
 
-        char payload[250];
-        strcat(payload, "");
-    
-        char stringifyValue[50];
-        sprintf(stringifyValue , "%.3f", currentSensor.value);
-
-
-        strcat(payload, "{");
-        strcat(payload, "\"sensorName\":");
-        strcat(payload, "\"");
-        strcat(payload,currentSensor.sensorName);
-        strcat(payload,"\",");
-        strcat(payload, "\n");
-        strcat(payload, "\"sensorType\":");
-        strcat(payload, "\"");
-        strcat(payload,currentSensor.sensorType);
-        strcat(payload,"\",");
-        strcat(payload, "\n");
-
-        strcat(payload, "\"origin\":\"physical Device\",");
-        strcat(payload, "\n");
-
-        strcat(payload, "\"sensorID\":\"");
-        strcat(payload,currentSensor.ID);
-        strcat(payload,"\",");
-        strcat(payload, "\n");
-
-        strcat(payload, "\"value\":");
-        strcat(payload,stringifyValue);
-        strcat(payload,",");
-        strcat(payload, "\n");
-
-        strcat(payload, "\"ID\":\"");
-        strcat(payload,randstring(32));
-        strcat(payload,"\"}");
-
-        printf("%s\n", "");
-        printf("%s\n",payload);
-        printf("%s\n", "");
-
-
-        // empty the strings once the payload is printed
-        strcpy(payload, "");
-        strcpy(stringifyValue, "");
-  
+    uint8_t payload[PAYLOAD_JSON_MAXLEN];
+    msgid_t id;
+
+    /* a preview, the ID is left for the next message */
+    msgid_peek(&id);
+    int len = encodeCurrentSensor(payload, sizeof(payload), &id);
+
+    if (len < 0) {
+        puts("error: payload does not fit into the buffer");
+        return 1;
     }
 
+    printEncoded(payload, len);
+
     return 0;
-    
 }
 
 /**
-* Configure the current sensor type
+* Configure the current sensor type, the sensor is given by name, UUID or
+* compact ID
 * Author: Giulio Serra serra.1904089@gmail.com
 */
 static int initSensor(int argc,char **argv){
 
-    (void)argc;
-    (void)argv;
-
     if(argc < 3){
         printf("%s\n", "You should specify <StationName> and <SensorName>");
         return 0;
     }
 
-    initWeatherStationsInformations();
+    int st = registry_station_by_name(argv[1]);
+    if(st < 0){
+        printf("WeatherStation %s not found.\n", argv[1]);
+        return 1;
+    }
+
+    int id = registry_sensor_find(argv[2]);
+    if(id < 0 || registry_sensor(id)->station != st){
+        printf("sensor %s not found.\n", argv[2]);
+        return 1;
+    }
 
-    for(int i=0; i<2; i++){
+    mutex_lock(&stationLock);
+    selectStation(st);
+    currentSensorIndex = id;
+    currentSlot = id - registry_station(st)->first;
+    currentSensor = selectedStation.sensors[currentSlot];
+    isSensorSelected = true;
+    mutex_unlock(&stationLock);
 
-        printf("Weather station: %s\n",stations[i].name);
-        printf("%s\n","");
+    printf("sensor: %s found\n", currentSensor.sensorName);
+    return 0;
+}
+
+
+/**
+* Configure the current board as a whole weather station
+*/
+static int initStation(int argc,char **argv){
+
+    if(argc < 2){
+        printf("%s\n", "You should specify <StationName>");
+        return 1;
+    }
 
-        if(strcmp(stations[i].name,argv[1]) == 0){
+    int st = registry_station_by_name(argv[1]);
+    if(st < 0){
+        printf("WeatherStation %s not found.\n", argv[1]);
+        return 1;
+    }
 
-            printf("Weather station: %s found",argv[1]);
-            printf("%s\n","");
+    mutex_lock(&stationLock);
+    selectStation(st);
+    mutex_unlock(&stationLock);
+    printf("Weather station: %s found\n",argv[1]);
+    return 0;
+}
 
-            for(int j=0; j<5; j++){
+/**
+* Seconds elapsed since boot, time base of the buffered readings
+*/
+static uint32_t uptimeSeconds(void){
 
-                if(strcmp(stations[i].sensors[j].sensorName,argv[2]) == 0){
+    return (uint32_t)(xtimer_now_usec64() / US_PER_SEC);
+}
 
-                    printf("sensor: %s found",argv[2]);
-                    printf("%s\n","");
-                    currentSensor = stations[i].sensors[j];
-                    isSensorSelected = true;
-                    return 0;
+/**
+* Results of semtech_loramac_send that leave the frame unsent, the link may
+* come back later. A confirmed frame without acknowledgment did go out, its
+* loss is only counted by the planner
+*/
+static bool loraFailed(uint8_t res){
 
+    return (res == SEMTECH_LORAMAC_NOT_JOINED) ||
+           (res == SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED) ||
+           (res == SEMTECH_LORAMAC_BUSY) ||
+           (res == SEMTECH_LORAMAC_TX_ERROR);
+}
 
-                }
-            }
+/**
+* Largest payload accepted at the data rate in use
+*/
+static size_t loraMaxPayload(void){
 
-            printf("sensor %s not found.\n", argv[2]);
-            return 1;
-        }
-     
-    }
+    size_t max = txplan_max_payload(semtech_loramac_get_dr(&loramac));
 
-    printf("WeatherStation %s not found.\n", argv[1]);
-    return 1;
+    return (max < LORAMAC_MAX_PAYLOAD_LEN) ? max : LORAMAC_MAX_PAYLOAD_LEN;
 }
 
+/**
+* Transmit a frame as is once the planner lets it go, confirmed or not as it
+* decides. A frame that would exceed the duty cycle is not handed to the MAC,
+* the outbox is replayed once it fits. loraLock must be held
+*/
+static uint8_t loraTransmit(uint8_t *payload, size_t len){
+
+    uint8_t port = LORAMAC_DEFAULT_TX_PORT; /* Default: 2 */
+    txplan_decision_t plan;
+
+    txplan_decide(&txPlan, xtimer_now_usec64(), semtech_loramac_get_dr(&loramac),
+                  len, outbox_count(&outbox), &plan);
+    if(plan.wait > 0){
+        txplan_defer(&txPlan);
+        telemetry_retry(plan.wait);
+        return SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED;
+    }
+
+    energy_state_t prev = energy_enter(ENERGY_STATE_TX);
+
+    semtech_loramac_set_tx_mode(&loramac, plan.confirmed ? LORAMAC_TX_CNF : LORAMAC_TX_UNCNF);
+    semtech_loramac_set_tx_port(&loramac, port);
+
+    TRACE("lora tx", len);
+    uint32_t start = perf_now();
+    uint8_t res = semtech_loramac_send(&loramac, payload, len);
+    perf_stop(&perfStages[PERF_SEND], start);
+    TRACE("lora result", res);
+
+    energy_enter(prev);
+
+    /* refused before reaching the air */
+    if(res != SEMTECH_LORAMAC_NOT_JOINED &&
+       res != SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED &&
+       res != SEMTECH_LORAMAC_BUSY){
+        txplan_spend(&txPlan, xtimer_now_usec64(), plan.airtime);
+    }
+    if(plan.confirmed && !loraFailed(res)){
+        txplan_confirmed(&txPlan, xtimer_now_usec64(),
+                         res != SEMTECH_LORAMAC_TX_CNF_FAILED);
+    }
+    return res;
+}
 
 /**
-* Send the data from the sensor over the LoRA channel
-* Author: Giulio Serra serra.1904089@gmail.com
+* Replay the frames of the outbox, oldest first and packed in batch frames,
+* until it is empty or the MAC refuses one. loraLock must be held
 */
-static int sendPayload(int argc,char **argv){
+static uint8_t drainOutbox(void){
+
+    uint8_t *batch = outboxBatch;
+    unsigned packed;
+
+    while(outbox_count(&outbox) > 0){
+        /* pack as many frames as the data rate allows */
+        size_t max = loraMaxPayload();
+        int len = outbox_batch(&outbox, batch, max, uptimeSeconds(), &packed);
+        if(len < 0){
+            /* too long to be packed, send the frame alone as it was */
+            len = outbox_peek(&outbox, batch, max);
+            packed = 1;
+        }
+        if(len < 0){
+            LOG_WARNING("frame too long for the data rate, dropped from the outbox\n");
+            outbox_consume(&outbox, 1);
+            continue;
+        }
 
-    (void)argc;
-    (void)argv;
+        uint8_t res = loraTransmit(batch, len);
+        if(loraFailed(res)){
+            return res;
+        }
 
-    if(!isSensorSelected){
-        printf("%s\n","You must first initialize the sensor");
+        LOG_INFO("%u frames replayed from the outbox\n", packed);
+        TRACE("outbox replay", packed);
+        outbox_consume(&outbox, packed);
+    }
+
+    return SEMTECH_LORAMAC_TX_DONE;
+}
+
+/**
+* Send an encoded payload over the LoRA channel, after the frames waiting in
+* the outbox. With store set a frame that cannot be sent is queued in the
+* outbox, otherwise the caller keeps it
+*/
+static int loraSend(uint8_t *payload, int len, bool store){
+
+    size_t max = loraMaxPayload();
+    if ((unsigned)len > max) {
+        LOG_WARNING("Cannot send: payload of %d bytes is too long for DR%d "
+               "(%u bytes), use the binary encoding\n", len,
+               semtech_loramac_get_dr(&loramac), (unsigned)max);
         return 1;
     }
 
-   
-    char payload[250];
-    strcat(payload, "");
-    
-    char stringifyValue[50];
-    sprintf(stringifyValue , "%.3f", currentSensor.value);
-
-    strcat(payload, "{");
-    strcat(payload, "\"sensorName\":");
-    strcat(payload, "\"");
-    strcat(payload,currentSensor.sensorName);
-    strcat(payload,"\",");
-    strcat(payload, "\n");
-    strcat(payload, "\"sensorType\":");
-    strcat(payload, "\"");
-    strcat(payload,currentSensor.sensorType);
-    strcat(payload,"\",");
-    strcat(payload, "\n");
-
-    strcat(payload, "\"origin\":\"physical Device\",");
-    strcat(payload, "\n");
-
-    strcat(payload, "\"sensorID\":\"");
-    strcat(payload,currentSensor.ID);
-    strcat(payload,"\",");
-    strcat(payload, "\n");
-
-    strcat(payload, "\"value\":");
-    strcat(payload,stringifyValue);
-    strcat(payload,",");
-    strcat(payload, "\n");
-
-    strcat(payload, "\"ID\":\"");
-    strcat(payload,randstring(32));
-    strcat(payload,"\"}");
-
-    
-    printf("%s\n", "");
-    printf("%s\n",payload);
-    printf("%s\n", "");
-
-
-    // now it sends the data over the LORA
-
-    uint8_t cnf = LORAMAC_DEFAULT_TX_MODE;  /* Default: confirmable */
-    uint8_t port = LORAMAC_DEFAULT_TX_PORT; /* Default: 2 */
-        
+    uint8_t res;
+    uint32_t start = perf_now();
 
-    semtech_loramac_set_tx_mode(&loramac, cnf);
-    semtech_loramac_set_tx_port(&loramac, port);
+    mutex_lock(&loraLock);
+
+    if(store && outbox_count(&outbox) > 0){
+        /* keep the order, the frame goes out behind the waiting ones */
+        outbox_push(&outbox, uptimeSeconds(), payload, len);
+        res = drainOutbox();
+    }
+    else{
+        res = drainOutbox();
+        if(!loraFailed(res)){
+            res = loraTransmit(payload, len);
+        }
+        if(loraFailed(res) && store){
+            outbox_push(&outbox, uptimeSeconds(), payload, len);
+        }
+    }
 
-    switch (semtech_loramac_send(&loramac,
-                                     (uint8_t *)payload, strlen(payload))) {
+    mutex_unlock(&loraLock);
+    perf_stop(&perfStages[PERF_UPLINK], start);
+
+    switch (res) {
         case SEMTECH_LORAMAC_NOT_JOINED:
-            puts("Cannot send: not joined");
-            strcpy(payload, "");
-            strcpy(stringifyValue, "");
-            return 1;
+            LOG_WARNING("Cannot send: not joined\n");
+            break;
 
         case SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED:
-            puts("Cannot send: dutycycle restriction");
-            strcpy(payload, ""); 
-            strcpy(stringifyValue, "");
-            return 1;
+            LOG_WARNING("Cannot send: dutycycle restriction\n");
+            break;
 
         case SEMTECH_LORAMAC_BUSY:
-            puts("Cannot send: MAC is busy");
-            strcpy(payload, ""); 
-            strcpy(stringifyValue, "");
-            return 1;
+            LOG_WARNING("Cannot send: MAC is busy\n");
+            break;
 
         case SEMTECH_LORAMAC_TX_ERROR:
-            puts("Cannot send: error");
-            strcpy(payload, ""); 
-            strcpy(stringifyValue, "");
-            return 1;
-    }
+            LOG_WARNING("Cannot send: error\n");
+            break;
 
-    // empty the strings once the payload is printed
+        case SEMTECH_LORAMAC_TX_CNF_FAILED:
+            LOG_WARNING("Heartbeat sent but not acknowledged\n");
+            break;
+    }
 
-    strcpy(payload, ""); 
-    strcpy(stringifyValue, "");
+    if(loraFailed(res)){
+        if(store){
+            LOG_INFO("%u frames waiting in the outbox\n", outbox_count(&outbox));
+        }
+        return 1;
+    }
 
     return 0;
 }
 
 /**
-* Send the data from the sensor over the LoRA channel 
+* Send the data from the sensor over the LoRA channel
 * Author: Giulio Serra serra.1904089@gmail.com
 */
-static int cicleTelemetry(int argc,char **argv){
+static int sendPayload(int argc,char **argv){
+
+    (void)argc;
+    (void)argv;
 
     if(!isSensorSelected){
         printf("%s\n","You must first initialize the sensor");
         return 1;
     }
-    
-    int seconds_before_retrasmission = 60 * MINUTES_BEFORE_RETRASMISSION;
 
-    printf("%s\n","starting the telemetry...\n");
+   
+    uint8_t payload[PAYLOAD_JSON_MAXLEN];
+    msgid_t id;
 
-    while(1){
-        printf("%s\n","sleeping...\n");
-        xtimer_sleep(seconds_before_retrasmission);
-        printf("%s\n","");
-        printf("%s\n","Sending telemetry over LoRA... \n");
-        sendPayload(argc,argv);
-        printf("%s\n","");
+    msgid_next(&id);
+    int len = encodeCurrentSensor(payload, sizeof(payload), &id);
+
+    if (len < 0) {
+        puts("error: payload does not fit into the buffer");
+        return 1;
     }
 
-    return 0; // should never been reached
+    logEncoded(payload, len);
+
+
+    return loraSend(payload, len, true);
 }
 
-/*------------------------------------------------------------------------------------------------------------------*/
+/**
+* Sample all the sensors of the selected station and send them in a single
+* uplink over the LoRA channel
+*/
+static int sendStation(int argc,char **argv){
 
+    (void)argc;
+    (void)argv;
 
+    if(!isStationSelected){
+        printf("%s\n","You must first initialize the station");
+        return 1;
+    }
 
-static const shell_command_t shell_commands[] = {
-    { "loramac", "control the loramac stack", _cmd_loramac },
-    { "printPay", "show a payload for the current sensor on the board.", buildPayload },
-    { "initSensor", "init the current board as a sensor of a weather station", initSensor},
-    { "sendPayload","send the telemetry using LoRa channel",sendPayload},
-    { "cicleTelemetry","send telemetry on LoRa channel with regular interval",cicleTelemetry},
-    { NULL, NULL, NULL }
-};
+    weatherStation *station = &selectedStation;
+    uint8_t payload[PAYLOAD_STATION_JSON_MAXLEN];
+    msgid_t id;
+    int len;
 
-int main(void)
-{
-    semtech_loramac_init(&loramac);
+    mutex_lock(&stationLock);
+    for(unsigned k = 0; k < station->numof; k++){
+        station->sensors[k].value = readSensor(&station->sensors[k]);
+    }
 
-    /*init of pseudo number generator*/
-    srand(time(NULL)); 
+    uint32_t encodeStart = perf_now();
+    msgid_next(&id);
 
-    if (hts221_init(&dev, &hts221_params[0]) != HTS221_OK) {
-        puts("Cannot initialize hts221 sensor");
-        isSensorInitialized = false;
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        weather_value_t values[WEATHER_SENSORS_NUMOF];
+
+        for(unsigned k = 0; k < station->numof; k++){
+            values[k] = station->sensors[k].value;
+        }
+        len = payload_station_frame(payload, sizeof(payload),
+                                    registry_station(currentStation)->first,
+                                    values, station->numof, id.seq);
     }
-    if (hts221_power_on(&dev) != HTS221_OK) {
-        puts("Failed to set hts221 power on");
-        isSensorInitialized = false;
-   
+    else{
+        len = payload_station_json((char *)payload, sizeof(payload), station, &id);
     }
-    if (hts221_set_rate(&dev, dev.p.rate) != HTS221_OK) {
-        puts("Failed to set hts221 continuous mode");
-        isSensorInitialized = false;
+
+    perf_stop(&perfStages[PERF_ENCODE], encodeStart);
+    mutex_unlock(&stationLock);
+    if (len < 0) {
+        puts("error: payload does not fit into the buffer");
+        return 1;
+    }
+
+    logEncoded(payload, len);
+
+    return loraSend(payload, len, true);
+}
+
+/**
+* Send the oldest buffered readings of a sensor in one compressed block, they
+* are dropped from the buffer only once the block was sent
+*/
+static int flushSeries(unsigned slot){
+
+    tsbuf_t *series = &sensorSeries[slot];
+    uint8_t *block = telemetryPayload;
+    unsigned encoded;
+    uint8_t index = registry_station(currentStation)->first + slot;
+
+    /* as many readings as the data rate in use allows */
+    uint32_t start = perf_now();
+    int len = tsbuf_encode(series, block, loraMaxPayload(), index, uptimeSeconds(), &encoded);
+    perf_stop(&perfStages[PERF_ENCODE], start);
+    if (len < 0) {
+        return 1;
+    }
+
+    LOG_INFO("sending %u of %u buffered readings in %d bytes\n",
+           encoded, tsbuf_count(series), len);
+
+    /* the readings stay in the buffer until sent, no copy in the outbox */
+    if (loraSend(block, len, false) != 0) {
+        LOG_INFO("%u readings kept for the next uplink\n", tsbuf_count(series));
+        return 1;
+    }
+
+    tsbuf_consume(series, encoded);
+    return 0;
+}
+
+/**
+* Send the summary of the current window of a sensor and open the next one, a
+* window without readings gets one taken now
+*/
+static int sendSummary(unsigned slot){
+
+    sensor *snr = &selectedStation.sensors[slot];
+    aggr_t *window = &sensorWindows[slot];
+    uint8_t *payload = telemetryPayload;
+    msgid_t id;
+    int len;
+
+    if(window->count == 0){
+        snr->value = readSensor(snr);
+        aggr_add(window, snr->value);
+    }
+
+    uint32_t encodeStart = perf_now();
+    msgid_next(&id);
+
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        len = payload_summary_frame(payload, sizeof(telemetryPayload),
+                                    registry_station(currentStation)->first + slot,
+                                    window, id.seq);
+    }
+    else{
+        len = payload_summary_json((char *)payload, sizeof(telemetryPayload), snr, window, &id);
+        /* too long for the data rate: the binary frame carries the same
+         * summary */
+        if(len > (int)loraMaxPayload()){
+            len = payload_summary_frame(payload, sizeof(telemetryPayload),
+                                        registry_station(currentStation)->first + slot,
+                                        window, id.seq);
+        }
+    }
+
+    perf_stop(&perfStages[PERF_ENCODE], encodeStart);
+    if (len < 0) {
+        LOG_ERROR("error: payload does not fit into the buffer\n");
+        return 1;
+    }
+
+    LOG_INFO("summary of %" PRIu32 " readings\n", window->count);
+    logEncoded(payload, len);
+
+    /* a summary that cannot be sent waits in the outbox, the next window
+     * opens once it is sent or queued; one still too long for the data rate
+     * is neither and the window goes on */
+    bool fits = len <= (int)loraMaxPayload();
+    int res = loraSend(payload, len, true);
+    if(fits){
+        aggr_init(window);
+    }
+    return res;
+}
+
+/**
+* Check whether a slot carries the wind record of the selected station, the
+* wind speed is sampled and sent along with the direction
+*/
+static bool isWindSlot(unsigned slot){
+
+    return summaryUplinks && slot == windDirectionSlot &&
+           windSpeedSlot < WEATHER_SENSORS_NUMOF;
+}
+
+/**
+* Check whether a slot is the wind speed, taken care of by the wind record
+*/
+static bool isWindSpeedSlot(unsigned slot){
+
+    return summaryUplinks && slot == windSpeedSlot &&
+           windDirectionSlot < WEATHER_SENSORS_NUMOF;
+}
+
+/**
+* Check whether a slot is a rain sensor read from the gauge, which counts the
+* rain between the reports by itself
+*/
+static bool isRainSlot(unsigned slot){
+
+    return summaryUplinks && rain_is_active() &&
+           selectedStation.sensors[slot].kind == WEATHER_KIND_RAIN;
+}
+
+/**
+* Send the rain counted by the gauge since the previous report
+*/
+static int sendRain(unsigned slot){
+
+    sensor *snr = &selectedStation.sensors[slot];
+    uint8_t *payload = telemetryPayload;
+    rain_report_t rain;
+    msgid_t id;
+    int len;
+
+    rain_take(&rain);
+    uint32_t encodeStart = perf_now();
+    msgid_next(&id);
+
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        len = payload_rain_frame(payload, sizeof(telemetryPayload),
+                                 registry_station(currentStation)->first + slot,
+                                 &rain, id.seq);
+    }
+    else{
+        len = payload_rain_json((char *)payload, sizeof(telemetryPayload), snr, &rain, &id);
+    }
+
+    perf_stop(&perfStages[PERF_ENCODE], encodeStart);
+    if (len < 0) {
+        LOG_ERROR("error: payload does not fit into the buffer\n");
+        return 1;
+    }
+
+    LOG_INFO("%" PRIu32 " tips in %" PRIu32 " s\n", rain.tips, rain.span);
+    logEncoded(payload, len);
+
+    return loraSend(payload, len, true);
+}
+
+/**
+* Send the wind vector summary of the current window and open the next one, a
+* window without readings gets one taken now
+*/
+static int sendWind(void){
+
+    sensor *dir = &selectedStation.sensors[windDirectionSlot];
+    sensor *speed = &selectedStation.sensors[windSpeedSlot];
+    uint8_t *payload = telemetryPayload;
+    msgid_t id;
+    int len;
+
+    if(windWindow.count == 0){
+        dir->value = readSensor(dir);
+        speed->value = readSensor(speed);
+        wind_add(&windWindow, dir->value, speed->value);
+    }
+
+    uint32_t encodeStart = perf_now();
+    msgid_next(&id);
+
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        uint8_t first = registry_station(currentStation)->first;
+        len = payload_wind_frame(payload, sizeof(telemetryPayload), first + windDirectionSlot,
+                                 first + windSpeedSlot, &windWindow, id.seq);
+    }
+    else{
+        len = payload_wind_json((char *)payload, sizeof(telemetryPayload), selectedStation.name,
+                                dir, speed, &windWindow, &id);
+    }
+
+    perf_stop(&perfStages[PERF_ENCODE], encodeStart);
+    if (len < 0) {
+        LOG_ERROR("error: payload does not fit into the buffer\n");
+        return 1;
+    }
+
+    LOG_INFO("wind summary of %" PRIu32 " readings\n", windWindow.count);
+    logEncoded(payload, len);
+
+    wind_init(&windWindow);
+    return loraSend(payload, len, true);
+}
+
+/**
+* Move the samples of the acquisition thread into the windows or the buffers
+* of the sensors of their kind, the buffered readings keep the time of the
+* conversion
+*/
+static void drainSamples(void){
+
+    uint32_t start = perf_now();
+    uint32_t nowMs = (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+    sampleq_entry_t e;
+
+    while(sampleq_pop(&acquiredSamples, &e)){
+        uint32_t time = uptimeSeconds() - (nowMs - e.time) / MS_PER_SEC;
+
+        TRACE("acquired", e.value);
+
+        for(unsigned k = 0; k < selectedStation.numof; k++){
+            sensor *snr = &selectedStation.sensors[k];
+            if(snr->kind != e.kind){
+                continue;
+            }
+            snr->value = e.value;
+            if(summaryUplinks){
+                aggr_add(&sensorWindows[k], e.value);
+            }
+            else{
+                tsbuf_push(&sensorSeries[k], time, e.value);
+            }
+        }
+    }
+
+    perf_stop(&perfStages[PERF_READ], start);
+}
+
+/**
+* Take a reading of a sensor of the selected station into its window or its
+* buffer
+*/
+static void storeSample(unsigned slot){
+
+    sensor *snr = &selectedStation.sensors[slot];
+
+    /* sampled by the acquisition thread, on its own schedule */
+    if(acquire_provides(snr->kind)){
+        drainSamples();
+        return;
+    }
+
+    energy_state_t prev = energy_enter(ENERGY_STATE_SENSE);
+
+    snr->value = readSensor(snr);
+    TRACE("sample", snr->value);
+    if(isWindSlot(slot)){
+        sensor *speed = &selectedStation.sensors[windSpeedSlot];
+        speed->value = readSensor(speed);
+        wind_add(&windWindow, snr->value, speed->value);
+    }
+    else if(isRainSlot(slot)){
+        /* the gauge keeps the counts, the reading only feeds the deadband */
+    }
+    else if(summaryUplinks){
+        aggr_add(&sensorWindows[slot], snr->value);
+    }
+    else{
+        tsbuf_push(&sensorSeries[slot], uptimeSeconds(), snr->value);
+    }
+
+    energy_enter(prev);
+}
+
+/**
+* Send the data of a sensor of the selected station, the deadband is now
+* centered on its latest reading
+*/
+static void reportSensor(unsigned slot, deadband_reason_t reason){
+
+    sensor *snr = &selectedStation.sensors[slot];
+
+    LOG_INFO("%s: report (%s)\n", snr->sensorName, deadband_reason_str(reason));
+    TRACE("report", slot);
+    deadband_reported(&sensorBands[slot], uptimeSeconds(), snr->value);
+
+    if(isWindSlot(slot)){
+        deadband_reported(&sensorBands[windSpeedSlot], uptimeSeconds(),
+                          selectedStation.sensors[windSpeedSlot].value);
+        sendWind();
+        return;
+    }
+
+    if(isRainSlot(slot)){
+        sendRain(slot);
+        return;
+    }
+
+    if(summaryUplinks){
+        sendSummary(slot);
+        return;
+    }
+
+    if(uplinkEncoding == PAYLOAD_ENCODING_BINARY){
+        flushSeries(slot);
+        return;
+    }
+
+    /* JSON carries a single reading, the most recent one */
+    uint8_t *payload = telemetryPayload;
+    msgid_t id;
+
+    uint32_t encodeStart = perf_now();
+    msgid_next(&id);
+    int len = payload_sensor_json((char *)payload, sizeof(telemetryPayload), snr, &id);
+    perf_stop(&perfStages[PERF_ENCODE], encodeStart);
+    if (len < 0) {
+        LOG_ERROR("error: payload does not fit into the buffer\n");
+        return;
+    }
+
+    logEncoded(payload, len);
+    loraSend(payload, len, true);
+}
+
+/**
+* Telemetry thread: sample a sensor of the selected station, a fast change is
+* reported at once. The station cannot change meanwhile, the shell waits for
+* the report to be sent
+*/
+static void telemetrySample(unsigned slot){
+
+    mutex_lock(&stationLock);
+
+    if(isWindSpeedSlot(slot)){
+        mutex_unlock(&stationLock);
+        return;
+    }
+
+    storeSample(slot);
+
+    deadband_reason_t reason = deadband_sample(&sensorBands[slot], uptimeSeconds(),
+                                               selectedStation.sensors[slot].value);
+    if(isWindSlot(slot)){
+        deadband_reason_t gust = deadband_sample(&sensorBands[windSpeedSlot], uptimeSeconds(),
+                                                 selectedStation.sensors[windSpeedSlot].value);
+        if(reason == DEADBAND_SKIP){
+            reason = gust;
+        }
+    }
+    if(reason != DEADBAND_SKIP){
+        reportSensor(slot, reason);
+    }
+
+    mutex_unlock(&stationLock);
+}
+
+/**
+* Telemetry thread: send the data of a sensor of the selected station, unless
+* its reading stayed in the deadband
+*/
+static void telemetryUplink(unsigned slot){
+
+    mutex_lock(&stationLock);
+
+    if(isWindSpeedSlot(slot)){
+        mutex_unlock(&stationLock);
+        return;
+    }
+
+    energy_cycle();
+
+    /* without sampling the uplink takes the reading itself */
+    if(telemetrySlots[slot].sample_period == 0){
+        storeSample(slot);
+    }
+
+    deadband_reason_t reason = deadband_check(&sensorBands[slot], uptimeSeconds(),
+                                              selectedStation.sensors[slot].value);
+    if(isWindSlot(slot) && reason == DEADBAND_SKIP){
+        reason = deadband_check(&sensorBands[windSpeedSlot], uptimeSeconds(),
+                                selectedStation.sensors[windSpeedSlot].value);
+    }
+    if(reason != DEADBAND_SKIP){
+        reportSensor(slot, reason);
+    }
+
+    mutex_unlock(&stationLock);
+}
+
+/**
+* Telemetry thread: replay the outbox once the duty cycle lets the frame
+* that was held back go
+*/
+static void telemetryRetry(void){
+
+    mutex_lock(&loraLock);
+    drainOutbox();
+    mutex_unlock(&loraLock);
+}
+
+static const telemetry_cb_t telemetryActions = {
+    .sample = telemetrySample,
+    .uplink = telemetryUplink,
+    .retry = telemetryRetry,
+};
+
+/**
+* Send the data from the sensor over the LoRA channel with regular interval,
+* the telemetry runs in its own thread so the shell stays available
+* Author: Giulio Serra serra.1904089@gmail.com
+*/
+static int cicleTelemetry(int argc,char **argv){
+
+    (void)argc;
+    (void)argv;
+
+    if(!isSensorSelected){
+        printf("%s\n","You must first initialize the sensor");
+        return 1;
+    }
+
+    unsigned slot = currentSlot;
+    uint32_t sample_s, uplink_s;
+
+    telemetry_get_periods(slot, &sample_s, &uplink_s);
+    if(sample_s == 0 && uplink_s == 0){
+        telemetry_set_periods(slot, SECONDS_BETWEEN_SAMPLES,
+                              60 * MINUTES_BEFORE_RETRASMISSION);
+        syncAcquisition();
+    }
+
+    printf("%s\n","starting the telemetry...\n");
+    telemetry_start();
+
+    return 0;
+}
+
+static void _telemetry_usage(void)
+{
+    puts("Usage: telemetry <start|stop|status|report <summary|raw>|"
+         "set <sensorName|all> <sample seconds> <uplink seconds>|");
+    puts("       deadband <sensorName|all> <width> <per mille> <silence seconds> "
+         "[<tenths per minute>]>");
+}
+
+/**
+* Control the telemetry thread: start, stop and change the periods of the
+* sensors of the selected station (a period of 0 disables it). Uplinks carry
+* the summary of the readings taken since the previous uplink, or with
+* "report raw" the readings themselves. The wind direction and speed make a
+* single wind vector summary, on the periods of the direction. A scheduled
+* uplink is skipped while the reading stays in the deadband of the sensor,
+* see deadband.h
+*/
+static int telemetryCmd(int argc,char **argv){
+
+    if(argc < 2){
+        _telemetry_usage();
+        return 1;
+    }
+
+    if(!isStationSelected){
+        printf("%s\n","You must first initialize the station");
+        return 1;
+    }
+
+    weatherStation *station = &selectedStation;
+
+    if(strcmp(argv[1], "start") == 0){
+        telemetry_start();
+    }
+    else if(strcmp(argv[1], "stop") == 0){
+        telemetry_stop();
+    }
+    else if(strcmp(argv[1], "status") == 0){
+        mutex_lock(&stationLock);
+        printf("telemetry %s, %s uplinks\n",
+               telemetry_is_running() ? "running" : "stopped",
+               summaryUplinks ? "summary" : "raw");
+        for(unsigned k = 0; k < station->numof; k++){
+            uint32_t sample_s, uplink_s;
+            telemetry_get_periods(k, &sample_s, &uplink_s);
+            printf("%s: sample every %" PRIu32 " s, uplink every %" PRIu32
+                   " s, ", station->sensors[k].sensorName, sample_s, uplink_s);
+            if(isWindSlot(k)){
+                printf("%" PRIu32 " in the wind window\n", windWindow.count);
+            }
+            else if(isWindSpeedSlot(k)){
+                printf("sampled with %s\n", station->sensors[windDirectionSlot].sensorName);
+            }
+            else if(summaryUplinks){
+                printf("%" PRIu32 " in the window\n", sensorWindows[k].count);
+            }
+            else{
+                printf("%u buffered\n", tsbuf_count(&sensorSeries[k]));
+            }
+
+            const deadband_t *band = &sensorBands[k];
+            printf("  deadband %u tenths or %u per mille, silence %" PRIu32
+                   " s, rate %u tenths/min: %" PRIu32 " reported, %" PRIu32
+                   " suppressed\n", band->cfg.width, band->cfg.share,
+                   band->cfg.silence, band->cfg.rate, band->reported,
+                   band->suppressed);
+        }
+        mutex_unlock(&stationLock);
+        if(acquire_is_running()){
+            printf("acquisition: %s, %u samples queued, %u dropped, %u failed reads\n",
+                   acquire_uses_drdy() ? "data ready" : "timer",
+                   sampleq_count(&acquiredSamples), sampleq_dropped(&acquiredSamples),
+                   acquire_failed());
+        }
+    }
+    else if(strcmp(argv[1], "deadband") == 0){
+        if(argc < 6){
+            _telemetry_usage();
+            return 1;
+        }
+
+        unsigned long width = strtoul(argv[3], NULL, 0);
+        unsigned long share = strtoul(argv[4], NULL, 0);
+        unsigned long silence = strtoul(argv[5], NULL, 0);
+        unsigned long rate = (argc > 6) ? strtoul(argv[6], NULL, 0) : 0;
+
+        /* the policy keeps 16 bit widths and rate, larger values would wrap */
+        if(width > UINT16_MAX || share > UINT16_MAX || rate > UINT16_MAX){
+            _telemetry_usage();
+            return 1;
+        }
+
+        deadband_cfg_t cfg = {
+            .width = width,
+            .share = share,
+            .silence = silence,
+            .rate = rate,
+        };
+        bool all = (strcmp(argv[2], "all") == 0);
+        bool found = false;
+
+        mutex_lock(&stationLock);
+        for(unsigned k = 0; k < station->numof; k++){
+            if(all || strcmp(station->sensors[k].sensorName, argv[2]) == 0){
+                cfg.wrap = sensorBands[k].cfg.wrap;
+                sensorBands[k].cfg = cfg;
+                found = true;
+            }
+        }
+        mutex_unlock(&stationLock);
+
+        if(!found){
+            printf("sensor %s not found.\n", argv[2]);
+            return 1;
+        }
+    }
+    else if(strcmp(argv[1], "report") == 0){
+        if(argc < 3 || (strcmp(argv[2], "summary") != 0 && strcmp(argv[2], "raw") != 0)){
+            _telemetry_usage();
+            return 1;
+        }
+
+        /* the readings taken so far went to the other store */
+        mutex_lock(&stationLock);
+        summaryUplinks = (strcmp(argv[2], "summary") == 0);
+        for(unsigned k = 0; k < WEATHER_SENSORS_NUMOF; k++){
+            tsbuf_init(&sensorSeries[k]);
+            aggr_init(&sensorWindows[k]);
+        }
+        wind_init(&windWindow);
+        mutex_unlock(&stationLock);
+    }
+    else if(strcmp(argv[1], "set") == 0){
+        if(argc < 5){
+            _telemetry_usage();
+            return 1;
+        }
+
+        uint32_t sample_s = strtoul(argv[3], NULL, 0);
+        uint32_t uplink_s = strtoul(argv[4], NULL, 0);
+        bool all = (strcmp(argv[2], "all") == 0);
+        bool found = false;
+
+        for(unsigned k = 0; k < station->numof; k++){
+            if(all || strcmp(station->sensors[k].sensorName, argv[2]) == 0){
+                telemetry_set_periods(k, sample_s, uplink_s);
+                found = true;
+            }
+        }
+
+        if(!found){
+            printf("sensor %s not found.\n", argv[2]);
+            return 1;
+        }
+        syncAcquisition();
+    }
+    else{
+        _telemetry_usage();
+        return 1;
+    }
+
+    return 0;
+}
+
+static void _power_usage(void)
+{
+    puts("Usage: power <normal|low|stats|reset>");
+}
+
+/**
+* Switch between the normal and the low power mode and report the estimated
+* energy used. In low power mode the HTS221 runs in one-shot mode and is
+* powered down between samples, and the MCU may enter LOWPOWER_PM_MODE, when
+* defined, while waiting for the next event.
+*/
+static int powerCmd(int argc,char **argv){
+
+    if(argc < 2){
+        printf("power mode: %s\n", lowPower ? "low" : "normal");
+        _power_usage();
+        return 1;
+    }
+
+    if(strcmp(argv[1], "low") == 0){
+        if(lowPower){
+            return 0;
+        }
+        if(acquire_is_running()){
+            acquire_set_low_power(true);
+        }
+#if defined(MODULE_PM_LAYERED) && defined(LOWPOWER_PM_MODE)
+        pm_unblock(LOWPOWER_PM_MODE);
+#endif
+        lowPower = true;
+        energy_enter(LOWPOWER_ENERGY_STATE);
+    }
+    else if(strcmp(argv[1], "normal") == 0){
+        if(!lowPower){
+            return 0;
+        }
+#if defined(MODULE_PM_LAYERED) && defined(LOWPOWER_PM_MODE)
+        pm_block(LOWPOWER_PM_MODE);
+#endif
+        if(acquire_is_running()){
+            acquire_set_low_power(false);
+        }
+        lowPower = false;
+        energy_enter(ENERGY_STATE_IDLE);
+    }
+    else if(strcmp(argv[1], "stats") == 0){
+        energy_print();
+    }
+    else if(strcmp(argv[1], "reset") == 0){
+        energy_reset();
+    }
+    else{
+        _power_usage();
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+* Select the encoding of the payloads sent over the LoRA channel
+*/
+static int setEncoding(int argc,char **argv){
+
+    if(argc < 2){
+        printf("encoding: %s\n",
+               (uplinkEncoding == PAYLOAD_ENCODING_BINARY) ? "binary" : "json");
+        printf("usage: %s <json|binary>\n", argv[0]);
+        return 1;
+    }
+
+    payload_encoding_t encoding;
+
+    if(strcmp(argv[1], "json") == 0){
+        encoding = PAYLOAD_ENCODING_JSON;
+    }
+    else if(strcmp(argv[1], "binary") == 0){
+        encoding = PAYLOAD_ENCODING_BINARY;
+    }
+    else{
+        printf("usage: %s <json|binary>\n", argv[0]);
+        return 1;
+    }
+
+    /* not while the telemetry thread is encoding a report */
+    mutex_lock(&stationLock);
+    uplinkEncoding = encoding;
+    mutex_unlock(&stationLock);
+
+    return 0;
+}
+
+#ifdef MODULE_PERIPH_EEPROM
+/**
+* Store the selected station in the EEPROM so the board starts as that
+* station, or forget it
+*/
+static int bootStation(int argc,char **argv){
+
+    if(argc < 2){
+        printf("usage: %s <save|erase>\n", argv[0]);
+        return 1;
+    }
+
+    if(strcmp(argv[1], "save") == 0){
+        if(!isStationSelected){
+            printf("%s\n","You must first initialize the station");
+            return 1;
+        }
+        if(registry_station_save(currentStation) != 0){
+            puts("error: unable to store the station");
+            return 1;
+        }
+        printf("Weather station: %s stored\n", selectedStation.name);
+    }
+    else if(strcmp(argv[1], "erase") == 0){
+        registry_station_erase();
+    }
+    else{
+        printf("usage: %s <save|erase>\n", argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
+static void _txplan_usage(void)
+{
+    puts("Usage: txplan <status|mode <heartbeat|auto|cnf|uncnf>>");
+}
+
+/**
+* Show the airtime budget and the plan of the next uplink, or choose how
+* the uplinks are confirmed
+*/
+static int txplanCmd(int argc,char **argv){
+
+    if(argc < 2){
+        _txplan_usage();
+        return 1;
+    }
+
+    if(strcmp(argv[1], "status") == 0){
+        txplan_decision_t plan;
+        uint8_t dr = semtech_loramac_get_dr(&loramac);
+
+        mutex_lock(&loraLock);
+        txplan_decide(&txPlan, xtimer_now_usec64(), dr, 0, outbox_count(&outbox), &plan);
+        mutex_unlock(&loraLock);
+
+        printf("DR%d (ADR %s): up to %u bytes, %" PRIu32 " ms on air\n", dr,
+               semtech_loramac_get_adr(&loramac) ? "on" : "off",
+               plan.max_len, plan.airtime / US_PER_MS);
+        printf("airtime available %" PRIu32 " ms, spent %" PRIu32 " ms, %"
+               PRIu32 " uplinks deferred\n", txPlan.credit / US_PER_MS,
+               txPlan.spent / US_PER_MS, txPlan.deferred);
+        printf("next uplink %s, in %" PRIu32 " s\n",
+               plan.confirmed ? "confirmed" : "unconfirmed", plan.wait / US_PER_SEC);
+        if(txPlan.acked){
+            printf("last acknowledgment %" PRIu32 " s ago, %" PRIu32
+                   " confirmed uplinks not acknowledged\n",
+                   (uint32_t)((xtimer_now_usec64() - txPlan.acked) / US_PER_SEC),
+                   txPlan.unacked);
+        }
+        else{
+            printf("no acknowledgment yet, %" PRIu32 " confirmed uplinks not "
+                   "acknowledged\n", txPlan.unacked);
+        }
+    }
+    else if(strcmp(argv[1], "mode") == 0 && argc >= 3){
+        txplan_mode_t mode;
+
+        if(strcmp(argv[2], "heartbeat") == 0){
+            mode = TXPLAN_MODE_HEARTBEAT;
+        }
+        else if(strcmp(argv[2], "auto") == 0){
+            mode = TXPLAN_MODE_AUTO;
+        }
+        else if(strcmp(argv[2], "cnf") == 0){
+            mode = TXPLAN_MODE_CONFIRMED;
+        }
+        else if(strcmp(argv[2], "uncnf") == 0){
+            mode = TXPLAN_MODE_UNCONFIRMED;
+        }
+        else{
+            _txplan_usage();
+            return 1;
+        }
+
+        /* the planner is used by the telemetry thread with loraLock held */
+        mutex_lock(&loraLock);
+        txPlan.mode = mode;
+        mutex_unlock(&loraLock);
+    }
+    else{
+        _txplan_usage();
+        return 1;
+    }
+
+    return 0;
+}
+
+static void _outbox_usage(void)
+{
+    puts("Usage: outbox <status|flush|clear>");
+}
+
+/**
+* Show the uplinks waiting for the link, replay them now or forget them
+*/
+static int outboxCmd(int argc,char **argv){
+
+    if(argc < 2){
+        _outbox_usage();
+        return 1;
+    }
+
+    if(strcmp(argv[1], "status") == 0){
+        printf("%u frames waiting (%u bytes), queued %" PRIu32 ", replayed %"
+               PRIu32 ", dropped %" PRIu32 "\n", outbox_count(&outbox),
+               outbox.used, outbox.queued, outbox.replayed, outbox.dropped);
+    }
+    else if(strcmp(argv[1], "flush") == 0){
+        mutex_lock(&loraLock);
+        uint8_t res = drainOutbox();
+        mutex_unlock(&loraLock);
+
+        if(loraFailed(res)){
+            printf("%u frames still waiting\n", outbox_count(&outbox));
+            return 1;
+        }
+    }
+    else if(strcmp(argv[1], "clear") == 0){
+        mutex_lock(&loraLock);
+        outbox_clear(&outbox);
+        mutex_unlock(&loraLock);
+    }
+    else{
+        _outbox_usage();
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+* Print the time spent in the stages of the telemetry pipeline, "perf reset"
+* prints and starts over
+*/
+static int perfCmd(int argc,char **argv){
+
+    bool reset = (argc >= 2 && strcmp(argv[1], "reset") == 0);
+
+    if(argc >= 2 && !reset){
+        printf("usage: %s [reset]\n", argv[0]);
+        return 1;
+    }
+
+    for(unsigned i = 0; i < PERF_NUMOF; i++){
+        perf_print(&perfStages[i]);
+        if(reset){
+            perf_reset(&perfStages[i]);
+        }
+    }
+
+    return 0;
+}
+
+#ifdef WEATHER_TRACE
+/**
+* Print the events recorded by the trace, or forget them
+*/
+static int traceCmd(int argc,char **argv){
+
+    if(argc < 2){
+        trace_print();
+    }
+    else if(strcmp(argv[1], "clear") == 0){
+        trace_clear();
+    }
+    else{
+        printf("usage: %s [clear]\n", argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
+/*------------------------------------------------------------------------------------------------------------------*/
+
+
+
+static const shell_command_t shell_commands[] = {
+    { "loramac", "control the loramac stack", _cmd_loramac },
+    { "printPay", "show a payload for the current sensor on the board.", buildPayload },
+    { "initSensor", "init the current board as a sensor of a weather station", initSensor},
+    { "printConfig", "print the stations and sensors known to the board", printConfig},
+    { "sendPayload","send the telemetry using LoRa channel",sendPayload},
+    { "initStation", "init the current board as a whole weather station", initStation},
+    { "sendStation","send the readings of all the station sensors in one LoRa uplink",sendStation},
+    { "cicleTelemetry","send telemetry on LoRa channel with regular interval",cicleTelemetry},
+    { "telemetry","start, stop and tune the periodic telemetry",telemetryCmd},
+    { "power","select the power mode and show the estimated energy used",powerCmd},
+    { "setEncoding","select the payload encoding (json or binary)",setEncoding},
+    { "outbox","show, replay or clear the uplinks waiting for the link",outboxCmd},
+    { "txplan","show the airtime budget and choose how uplinks are confirmed",txplanCmd},
+    { "perf","print the time spent in the telemetry stages, reset starts over",perfCmd},
+#ifdef WEATHER_TRACE
+    { "trace","print the recorded telemetry events",traceCmd},
+#endif
+#ifdef MODULE_PERIPH_EEPROM
+    { "bootStation","store the selected station as the one of the board at boot",bootStation},
+#endif
+    { NULL, NULL, NULL }
+};
+
+int main(void)
+{
+    semtech_loramac_init(&loramac);
+
+    /*init of pseudo number generator*/
+    srand(time(NULL)); 
+
+    for(unsigned k = 0; k < WEATHER_SENSORS_NUMOF; k++){
+        tsbuf_init(&sensorSeries[k]);
+        aggr_init(&sensorWindows[k]);
+    }
+    wind_init(&windWindow);
+
+    energy_reset();
+
+    /* the node of the message IDs is the DevEUI restored by the MAC, without
+     * EEPROM the boot epoch is the time of boot */
+    uint8_t deveui[LORAMAC_DEVEUI_LEN];
+    semtech_loramac_get_deveui(&loramac, deveui);
+    fmt_bytes_hex(nodeId, deveui, LORAMAC_DEVEUI_LEN);
+    nodeId[LORAMAC_DEVEUI_LEN * 2] = '\0';
+    msgid_init(nodeId, (uint32_t)time(NULL));
+
+#ifdef RAIN_GAUGE_PIN
+    if (rain_init(RAIN_GAUGE_PIN) != 0) {
+        puts("Cannot initialize the rain gauge, the rain is simulated");
+    }
+#endif
+
+    perf_init();
+    txplan_init(&txPlan, xtimer_now_usec64());
+    outbox_init(&outbox);
+#ifdef MODULE_PERIPH_EEPROM
+    int restored = outbox_attach(&outbox, OUTBOX_EEPROM_START, uptimeSeconds());
+    if (restored > 0) {
+        printf("%d uplinks restored in the outbox\n", restored);
+    }
+#endif
+
+    telemetry_init(telemetryStack, sizeof(telemetryStack), THREAD_PRIORITY_MAIN - 1,
+                   telemetrySlots, WEATHER_SENSORS_NUMOF, &telemetryActions);
+
+    if (registry_init() != 0) {
+        puts("Invalid station topology");
+    }
+#ifdef MODULE_PERIPH_EEPROM
+    else {
+        int st = registry_station_load();
+        if (st >= 0) {
+            mutex_lock(&stationLock);
+            selectStation(st);
+            mutex_unlock(&stationLock);
+            printf("Weather station: %s restored\n", selectedStation.name);
+        }
+    }
+#endif
+
+    if (hts221_init(&dev, &hts221_params[0]) != HTS221_OK) {
+        puts("Cannot initialize hts221 sensor");
+        isSensorInitialized = false;
+    }
+    if (hts221_power_on(&dev) != HTS221_OK) {
+        puts("Failed to set hts221 power on");
+        isSensorInitialized = false;
+   
+    }
+    if (hts221_set_rate(&dev, dev.p.rate) != HTS221_OK) {
+        puts("Failed to set hts221 continuous mode");
+        isSensorInitialized = false;
+    }
+
+    /* from now on only the acquisition thread talks to the HTS221 */
+    if (isSensorInitialized) {
+        sampleq_init(&acquiredSamples);
+        if (acquire_init(acquireStack, sizeof(acquireStack), THREAD_PRIORITY_MAIN - 2,
+                         &dev, &acquiredSamples, HTS221_DRDY_PIN) < 0) {
+            puts("Cannot start the hts221 acquisition");
+            isSensorInitialized = false;
+        }
+        else {
+            syncAcquisition();
+        }
     }
 
     puts("All up, running the shell now");
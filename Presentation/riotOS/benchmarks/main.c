@@ -0,0 +1,366 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Microbenchmarks of the weather station hot paths
+ *
+ * Every benchmark times BENCH_ITERATIONS operations and reports the time,
+ * the bytes produced and the bytes passed to malloc() per operation, and
+ * how much the heap grew over the whole run. The growth is read from the
+ * program break, so it includes what the C library allocates for itself,
+ * e.g. the buffers of the float formatting, which it keeps after their
+ * first use: they show up in the first benchmark needing them. The code the
+ * stations used before the weather module, the strcat payload, randstring(),
+ * the float formatting and the station table rebuilt by
+ * initWeatherStationsInformations(), is kept here as the baseline of the
+ * current encoders, so a change to the hot path is measured against both.
+ *
+ * Builds for native and b-l072z-lrwan1, the results are printed once at boot.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xtimer.h"
+
+#include "weather.h"
+#include "payload.h"
+#include "registry.h"
+#include "msgid.h"
+
+/**
+ * @brief   Operations timed per benchmark
+ */
+#ifndef BENCH_ITERATIONS
+#ifdef BOARD_NATIVE
+#define BENCH_ITERATIONS    (100000U)
+#else
+#define BENCH_ITERATIONS    (1000U)
+#endif
+#endif
+
+/* bytes passed to malloc() by the baseline code, the only one to call it */
+static size_t _requested;
+
+/* results are stored here so the work is not optimized away */
+static volatile uint32_t _sink;
+
+static void *_bench_malloc(size_t size)
+{
+    _requested += size;
+    return malloc(size);
+}
+
+/*
+ * Baseline: the code of the stations before the weather module, with the
+ * payload buffer cleared and the random string freed so it can run in a loop
+ */
+
+typedef struct {
+    const char *ID;
+    float value;
+    const char *sensorName;
+    const char *sensorType;
+} _legacy_sensor_t;
+
+typedef struct {
+    _legacy_sensor_t sensors[5];
+    const char *name;
+} _legacy_station_t;
+
+static _legacy_station_t _legacy_stations[2];
+
+static float _legacy_read(void)
+{
+    int MAX_TEMP = 100;
+    float coeff = ((float)rand()/(float)(RAND_MAX));
+
+    return MAX_TEMP * coeff;
+}
+
+static char *_legacy_randstring(int length)
+{
+    static char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789#?!";
+    char *randomString = NULL;
+
+    if (length) {
+        randomString = _bench_malloc(sizeof(char) * (length + 1));
+
+        if (randomString) {
+            for (int n = 0; n < length; n++) {
+                int key = rand() % (int)(sizeof(charset) - 1);
+                randomString[n] = charset[key];
+            }
+
+            randomString[length] = '\0';
+        }
+    }
+
+    return randomString;
+}
+
+static size_t _legacy_payload(const _legacy_sensor_t *s, char *payload)
+{
+    char stringifyValue[50];
+    char *id = _legacy_randstring(32);
+
+    payload[0] = '\0';
+    sprintf(stringifyValue, "%.3f", s->value);
+
+    strcat(payload, "{");
+    strcat(payload, "\"sensorName\":");
+    strcat(payload, "\"");
+    strcat(payload, s->sensorName);
+    strcat(payload, "\",");
+    strcat(payload, "\n");
+    strcat(payload, "\"sensorType\":");
+    strcat(payload, "\"");
+    strcat(payload, s->sensorType);
+    strcat(payload, "\",");
+    strcat(payload, "\n");
+    strcat(payload, "\"origin\":\"physical Device\",");
+    strcat(payload, "\n");
+    strcat(payload, "\"sensorID\":\"");
+    strcat(payload, s->ID);
+    strcat(payload, "\",");
+    strcat(payload, "\n");
+    strcat(payload, "\"value\":");
+    strcat(payload, stringifyValue);
+    strcat(payload, ",");
+    strcat(payload, "\n");
+    strcat(payload, "\"ID\":\"");
+    strcat(payload, id);
+    strcat(payload, "\"}");
+
+    free(id);
+    return strlen(payload);
+}
+
+/* the table print of initWeatherStationsInformations() is left out, it is
+ * bound by the UART */
+static void _legacy_init_stations(void)
+{
+    _legacy_station_t charlie;
+    _legacy_station_t tango;
+
+    charlie.name = "Charlie";
+
+    _legacy_sensor_t tempC = {"2a92abd7-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"temperatureCharlie","temperaturature"};
+    _legacy_sensor_t humC =  {"2a92abd8-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"humidityCharlie","humidity"};
+    _legacy_sensor_t wDirC = {"2a92abd9-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"windDirectionCharlie","WindDirection"};
+    _legacy_sensor_t wIntC = {"2a92abda-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"windIntensityCharlie","WindIntensity"};
+    _legacy_sensor_t rainC = {"2a92abdb-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"rainHeightCharlie","rain"};
+
+    charlie.sensors[0] = tempC;
+    charlie.sensors[1] = humC;
+    charlie.sensors[2] = wDirC;
+    charlie.sensors[3] = wIntC;
+    charlie.sensors[4] = rainC;
+
+    tango.name = "Tango";
+
+    _legacy_sensor_t tempT = {"2a92abd2-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"temperatureTango","temperaturature"};
+    _legacy_sensor_t humT =  {"2a92abd3-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"humidityTango","humidity"};
+    _legacy_sensor_t wDirT = {"2a92abd4-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"windDirectionTango","WindDirection"};
+    _legacy_sensor_t wIntT = {"2a92abd5-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"windIntensityTango","WindIntensity"};
+    _legacy_sensor_t rainT = {"2a92abd6-6d09-11ea-b89f-8f444e8fb0fc",_legacy_read(),"rainHeightTango","rain"};
+
+    tango.sensors[0] = tempT;
+    tango.sensors[1] = humT;
+    tango.sensors[2] = wDirT;
+    tango.sensors[3] = wIntT;
+    tango.sensors[4] = rainT;
+
+    _legacy_stations[0] = charlie;
+    _legacy_stations[1] = tango;
+}
+
+/*
+ * Benchmarks, every one does a single operation and returns the bytes it
+ * produced
+ */
+
+static sensor _sensor;
+static char _text[PAYLOAD_STATION_JSON_MAXLEN];
+
+static size_t _bench_legacy_payload(void)
+{
+    _legacy_sensor_t s = { _sensor.ID, _legacy_read(), _sensor.sensorName,
+                           _sensor.sensorType };
+
+    return _legacy_payload(&s, _text);
+}
+
+static size_t _bench_json_payload(void)
+{
+    msgid_t id;
+
+    _sensor.value = rand() % (100 * WEATHER_VALUE_SCALE + 1);
+    msgid_next(&id);
+    int len = payload_sensor_json(_text, sizeof(_text), &_sensor, &id);
+    return (len < 0) ? 0 : len;
+}
+
+static size_t _bench_binary_payload(void)
+{
+    msgid_t id;
+
+    _sensor.value = rand() % (100 * WEATHER_VALUE_SCALE + 1);
+    msgid_next(&id);
+    int len = payload_reading_frame((uint8_t *)_text, sizeof(_text), 0,
+                                    _sensor.value, id.seq);
+    return (len < 0) ? 0 : len;
+}
+
+static size_t _bench_legacy_randstring(void)
+{
+    char *id = _legacy_randstring(32);
+    size_t len = strlen(id);
+
+    _sink += id[0];
+    free(id);
+    return len;
+}
+
+static size_t _bench_msgid(void)
+{
+    msgid_t id;
+    payload_t p;
+
+    msgid_next(&id);
+    payload_init(&p, _text, sizeof(_text));
+    payload_append_msgid(&p, &id);
+    int len = payload_finish(&p);
+    return (len < 0) ? 0 : len;
+}
+
+static size_t _bench_printf_float(void)
+{
+    int len = snprintf(_text, sizeof(_text), "%.3f", _legacy_read());
+
+    return (len < 0) ? 0 : len;
+}
+
+static size_t _bench_fixed(void)
+{
+    payload_t p;
+
+    payload_init(&p, _text, sizeof(_text));
+    payload_append_fixed(&p, rand() % (100 * WEATHER_VALUE_SCALE + 1), 1);
+    int len = payload_finish(&p);
+    return (len < 0) ? 0 : len;
+}
+
+static size_t _bench_legacy_stations(void)
+{
+    _legacy_init_stations();
+    _sink += _legacy_stations[1].sensors[4].ID[0];
+    return sizeof(_legacy_stations);
+}
+
+/* what selectStation() does for every station of the registry */
+static size_t _bench_registry_stations(void)
+{
+    static weatherStation st;
+    size_t bytes = 0;
+
+    for (unsigned i = 0; i < registry_stations_numof; i++) {
+        const registry_station_t *rs = registry_station(i);
+
+        st.name = rs->name;
+        st.numof = rs->numof;
+        for (unsigned k = 0; k < rs->numof; k++) {
+            const registry_sensor_t *snr = registry_sensor(rs->first + k);
+            st.sensors[k] = (sensor){ snr->ID, 0, snr->sensorName,
+                                      snr->sensorType, snr->kind };
+        }
+        bytes += sizeof(st);
+    }
+    _sink += st.sensors[0].ID[0];
+    return bytes;
+}
+
+static size_t _bench_legacy_read(void)
+{
+    float value = _legacy_read();
+
+    _sink += (uint32_t)value;
+    return sizeof(value);
+}
+
+static size_t _bench_fixed_read(void)
+{
+    weather_value_t value = rand() % (100 * WEATHER_VALUE_SCALE + 1);
+
+    _sink += value;
+    return sizeof(value);
+}
+
+typedef struct {
+    const char *name;
+    size_t (*run)(void);
+} _bench_t;
+
+static const _bench_t _benches[] = {
+    { "payload strcat (old)", _bench_legacy_payload },
+    { "payload json", _bench_json_payload },
+    { "payload binary frame", _bench_binary_payload },
+    { "randstring(32) (old)", _bench_legacy_randstring },
+    { "msgid", _bench_msgid },
+    { "printf_float %.3f (old)", _bench_printf_float },
+    { "fixed point tenths", _bench_fixed },
+    { "stations rebuild (old)", _bench_legacy_stations },
+    { "stations from registry", _bench_registry_stations },
+    { "read float (old)", _bench_legacy_read },
+    { "read fixed point", _bench_fixed_read },
+};
+
+static void _run(const _bench_t *b)
+{
+    size_t bytes = 0;
+
+    _requested = 0;
+
+    char *brk = sbrk(0);
+    uint64_t start = xtimer_now_usec64();
+    for (unsigned i = 0; i < BENCH_ITERATIONS; i++) {
+        bytes += b->run();
+    }
+    uint64_t elapsed = xtimer_now_usec64() - start;
+    long grown = (char *)sbrk(0) - brk;
+
+    printf("%-24s %10" PRIu32 " %8u %11u %8ld\n", b->name,
+           (uint32_t)(elapsed * 1000 / BENCH_ITERATIONS),
+           (unsigned)(bytes / BENCH_ITERATIONS),
+           (unsigned)(_requested / BENCH_ITERATIONS), grown);
+}
+
+int main(void)
+{
+    msgid_init("bench", 0);
+    if (registry_init() != 0) {
+        puts("Invalid station topology");
+        return 1;
+    }
+
+    const registry_sensor_t *snr = registry_sensor(0);
+    _sensor = (sensor){ snr->ID, 0, snr->sensorName, snr->sensorType, snr->kind };
+
+    printf("weather benchmarks on %s, %u operations each\n", RIOT_BOARD,
+           (unsigned)BENCH_ITERATIONS);
+    printf("%-24s %10s %8s %11s %8s\n", "benchmark", "ns/op", "B/op", "malloc B/op",
+           "heap B");
+    for (unsigned i = 0; i < sizeof(_benches) / sizeof(_benches[0]); i++) {
+        _run(&_benches[i]);
+    }
+    puts("done");
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Streaming summary of the readings of a sensor
+ */
+
+#include "aggr.h"
+
+#define ONE                 ((int64_t)1 << AGGR_FRAC)
+/* the deviations are multiplied at half the precision, so their product
+ * stays within 64 bit for any pair of int16_t readings */
+#define HALF                ((int64_t)1 << (AGGR_FRAC / 2))
+
+static uint64_t _isqrt(uint64_t x)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/* round a fixed point number to the nearest integer, halves away from 0 */
+static weather_value_t _round(int64_t fixed, int64_t one)
+{
+    int64_t half = one / 2;
+
+    return (fixed < 0) ? -((-fixed + half) / one) : (fixed + half) / one;
+}
+
+void aggr_init(aggr_t *a)
+{
+    a->count = 0;
+    a->min = INT16_MAX;
+    a->max = INT16_MIN;
+    a->mean = 0;
+    a->m2 = 0;
+}
+
+void aggr_add(aggr_t *a, weather_value_t value)
+{
+    int64_t x = (int64_t)value * ONE;
+
+    if (a->count == UINT32_MAX) {
+        return;
+    }
+
+    a->count++;
+    if (value < a->min) {
+        a->min = value;
+    }
+    if (value > a->max) {
+        a->max = value;
+    }
+
+    /* deviations from the mean before and after the update have the same
+     * sign, their product is never negative */
+    int64_t delta = x - a->mean;
+    a->mean += delta / (int64_t)a->count;
+    int64_t delta2 = x - a->mean;
+    a->m2 += (uint64_t)((delta / HALF) * (delta2 / HALF));
+}
+
+weather_value_t aggr_mean(const aggr_t *a)
+{
+    return a->count ? _round(a->mean, ONE) : 0;
+}
+
+weather_value_t aggr_stddev(const aggr_t *a)
+{
+    if (a->count < 2) {
+        return 0;
+    }
+
+    /* the root of a variance with 2 * AGGR_FRAC fractional bits has
+     * AGGR_FRAC of them */
+    uint64_t root = _isqrt((a->m2 / a->count) << AGGR_FRAC);
+    uint64_t stddev = (root + ONE / 2) >> AGGR_FRAC;
+
+    return (stddev > INT16_MAX) ? INT16_MAX : (weather_value_t)stddev;
+}
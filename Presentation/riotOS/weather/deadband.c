@@ -0,0 +1,138 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Report-by-exception policy of a sensor
+ */
+
+#include "deadband.h"
+#include "wind.h"
+
+#define HAS_LAST            (0x01)
+#define HAS_PREV            (0x02)
+
+/* widths in tenths and shares in per mille, by kind of measure */
+static const deadband_cfg_t _defaults[WEATHER_KIND_NUMOF] = {
+    [WEATHER_KIND_TEMPERATURE] = { 2, 0, DEADBAND_SILENCE_DEFAULT, 0, 0 },
+    [WEATHER_KIND_HUMIDITY] = { 10, 0, DEADBAND_SILENCE_DEFAULT, 0, 0 },
+    [WEATHER_KIND_WIND_DIRECTION] = { 100, 0, DEADBAND_SILENCE_DEFAULT, 0, WIND_TURN },
+    [WEATHER_KIND_WIND_INTENSITY] = { 5, 100, DEADBAND_SILENCE_DEFAULT, 0, 0 },
+    [WEATHER_KIND_RAIN] = { 2, 0, DEADBAND_SILENCE_DEFAULT, 0, 0 },
+};
+
+static const char *_reasons[] = {
+    [DEADBAND_SKIP] = "skip",
+    [DEADBAND_FIRST] = "first",
+    [DEADBAND_CHANGE] = "change",
+    [DEADBAND_HEARTBEAT] = "heartbeat",
+    [DEADBAND_RATE] = "rate",
+};
+
+static uint32_t _distance(weather_value_t a, weather_value_t b)
+{
+    return (a > b) ? (int32_t)a - b : (int32_t)b - a;
+}
+
+/* distance the short way round for a circular measure */
+static uint32_t _gap(const deadband_t *d, weather_value_t a, weather_value_t b)
+{
+    uint32_t gap = _distance(a, b);
+
+    if (d->cfg.wrap) {
+        gap %= d->cfg.wrap;
+        if (gap > d->cfg.wrap - gap) {
+            gap = d->cfg.wrap - gap;
+        }
+    }
+    return gap;
+}
+
+/* true if value left the deadband around the last report */
+static int _outside(const deadband_t *d, weather_value_t value)
+{
+    uint32_t magnitude = _distance(d->last, 0);
+    uint32_t band = (uint32_t)d->cfg.share * magnitude / 1000U;
+
+    if (band < d->cfg.width) {
+        band = d->cfg.width;
+    }
+    return _gap(d, value, d->last) > band;
+}
+
+void deadband_default(deadband_cfg_t *cfg, weather_kind_t kind)
+{
+    if (kind < WEATHER_KIND_NUMOF) {
+        *cfg = _defaults[kind];
+    }
+    else {
+        *cfg = (deadband_cfg_t){ 0, 0, DEADBAND_SILENCE_DEFAULT, 0, 0 };
+    }
+}
+
+void deadband_init(deadband_t *d, const deadband_cfg_t *cfg)
+{
+    d->cfg = *cfg;
+    d->last = 0;
+    d->prev = 0;
+    d->last_time = 0;
+    d->prev_time = 0;
+    d->reported = 0;
+    d->suppressed = 0;
+    d->flags = 0;
+}
+
+deadband_reason_t deadband_check(deadband_t *d, uint32_t now,
+                                 weather_value_t value)
+{
+    if (!(d->flags & HAS_LAST)) {
+        return DEADBAND_FIRST;
+    }
+    if (d->cfg.silence && (now - d->last_time >= d->cfg.silence)) {
+        return DEADBAND_HEARTBEAT;
+    }
+    if (((d->cfg.width == 0) && (d->cfg.share == 0)) || _outside(d, value)) {
+        return DEADBAND_CHANGE;
+    }
+
+    d->suppressed++;
+    return DEADBAND_SKIP;
+}
+
+deadband_reason_t deadband_sample(deadband_t *d, uint32_t now,
+                                  weather_value_t value)
+{
+    deadband_reason_t reason = DEADBAND_SKIP;
+
+    /* a change of rate tenths per minute over now - prev_time seconds */
+    if (d->cfg.rate && (d->flags & HAS_LAST) && (d->flags & HAS_PREV) &&
+        (now > d->prev_time) &&
+        ((uint64_t)_gap(d, value, d->prev) * 60U >=
+         (uint64_t)d->cfg.rate * (now - d->prev_time)) &&
+        _outside(d, value)) {
+        reason = DEADBAND_RATE;
+    }
+
+    d->prev = value;
+    d->prev_time = now;
+    d->flags |= HAS_PREV;
+
+    return reason;
+}
+
+void deadband_reported(deadband_t *d, uint32_t now, weather_value_t value)
+{
+    d->last = value;
+    d->last_time = now;
+    d->reported++;
+    d->flags |= HAS_LAST;
+}
+
+const char *deadband_reason_str(deadband_reason_t reason)
+{
+    return ((unsigned)reason < sizeof(_reasons) / sizeof(_reasons[0])) ?
+           _reasons[reason] : "?";
+}
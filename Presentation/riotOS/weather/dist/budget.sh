@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Flash and RAM used per module and by the firmware, see Makefile.memory.
+#
+# usage: budget.sh <bindir> <elffile> [<flash budget> [<ram budget>]]
+#
+# The module sizes come from the objects of the build, before the linker
+# drops the unused sections, they tell where the memory goes. The totals
+# come from the firmware and are the ones checked against the budgets.
+
+BINDIR=$1
+ELFFILE=$2
+BUDGET_FLASH=$3
+BUDGET_RAM=$4
+SIZE=${SIZE:-size}
+
+if [ -z "$BINDIR" ] || [ ! -f "$ELFFILE" ]; then
+    echo "usage: $0 <bindir> <elffile> [<flash budget> [<ram budget>]]" >&2
+    exit 2
+fi
+
+printf '%-24s %8s %8s %8s %8s %8s\n' module text data bss flash ram
+for dir in "$BINDIR"/*/; do
+    module=$(basename "$dir")
+    set -- "$dir"*.o
+    [ -f "$1" ] || continue
+    "$SIZE" -t "$@" | tail -n 1 | awk -v m="$module" \
+        '{ printf "%-24s %8d %8d %8d %8d %8d\n", m, $1, $2, $3, $1 + $2, $2 + $3 }'
+done | sort -k 6 -n -r
+
+"$SIZE" "$ELFFILE" | tail -n 1 | awk \
+    -v bflash="$BUDGET_FLASH" -v bram="$BUDGET_RAM" '
+{
+    flash = $1 + $2
+    ram = $2 + $3
+    printf "%-24s %8d %8d %8d %8d %8d\n", "total", $1, $2, $3, flash, ram
+    fail = 0
+    if (bflash != "") {
+        printf "flash %d of %d bytes (%d%%)\n", flash, bflash, flash * 100 / bflash
+        if (flash > bflash) {
+            print "flash budget exceeded by " flash - bflash " bytes"
+            fail = 1
+        }
+    }
+    if (bram != "") {
+        printf "ram   %d of %d bytes (%d%%)\n", ram, bram, ram * 100 / bram
+        if (ram > bram) {
+            print "ram budget exceeded by " ram - bram " bytes"
+            fail = 1
+        }
+    }
+    exit fail
+}'
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v2.1. See the file LICENSE in the top level
+# directory for more details.
+#
+# Build time tables derived from the topology file of an application, the
+# same file weather/topology.c compiles into the registry.
+#
+# usage: topology.py [--check] index <topology.def> <registry_index.h>
+#        topology.py [--check] decoder <topology.def> <topology.js>
+#
+# --check: compare with the output instead of writing it and fail when it is
+# out of date, for the tables that are committed along with the backend.
+#
+# index: the hash indexes of the registry, see registry.c. Every index has at
+# least twice as many buckets as entries, so a lookup probes about 1.5
+# buckets on average whatever the size of the topology.
+#
+# decoder: the sensors in the order of their compact ID, for the backend
+# decoder of the binary frames (Application Logic/API/PayloadDecoder).
+
+import os
+import re
+import sys
+
+STATION = re.compile(r'WEATHER_STATION\(\s*(\w+)\s*,\s*(\d+)\s*\)')
+SENSOR = re.compile(r'WEATHER_SENSOR\(\s*(\w+)\s*,\s*"([^"\\]*)"\s*,\s*"([^"\\]*)"'
+                    r'\s*,\s*"([^"\\]*)"\s*,\s*(\w+)\s*\)')
+COMMENT = re.compile(r'/\*.*?\*/|//[^\n]*', re.S)
+
+# compact IDs are carried in one byte by the binary frames
+SENSORS_MAX = 256
+
+
+def parse(path):
+    """Stations as (name, numof) and sensors as (station, uuid, name, type,
+    kind), in the order of the file"""
+    with open(path) as f:
+        text = COMMENT.sub('', f.read())
+
+    stations = [(m.group(1), int(m.group(2))) for m in STATION.finditer(text)]
+    sensors = [m.groups() for m in SENSOR.finditer(text)]
+
+    if len(sensors) != sum(numof for _, numof in stations):
+        sys.exit('%s: the sensors listed do not match the sensor counts of '
+                 'the stations' % path)
+    if len(sensors) > SENSORS_MAX:
+        sys.exit('%s: %d sensors, the binary frames carry at most %d'
+                 % (path, len(sensors), SENSORS_MAX))
+    return stations, sensors
+
+
+def fnv1a(key):
+    """Hash of registry.c"""
+    h = 2166136261
+    for b in key.encode():
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def buckets(numof):
+    """Smallest power of two with at least two buckets per entry"""
+    size = 2
+    while size < 2 * numof:
+        size *= 2
+    return size
+
+
+def build(keys):
+    """Linear probing index, buckets hold the position of the entry + 1"""
+    size = buckets(len(keys))
+    index = [0] * size
+    for pos, key in enumerate(keys):
+        b = fnv1a(key)
+        while index[b & (size - 1)]:
+            b += 1
+        index[b & (size - 1)] = pos + 1
+    return index
+
+
+def c_array(name, index):
+    rows = []
+    for i in range(0, len(index), 12):
+        rows.append('    ' + ', '.join('%d' % e for e in index[i:i + 12]) + ',')
+    return ('static const uint16_t %s[%d] = {\n%s\n};\n'
+            % (name, len(index), '\n'.join(rows)))
+
+
+def source(src):
+    """The topology file with its application, e.g. IOT-Assignment-3/topology.def"""
+    path = os.path.abspath(src)
+    return os.path.join(os.path.basename(os.path.dirname(path)), os.path.basename(path))
+
+
+def index_header(src, stations, sensors):
+    out = ['/* generated by topology.py from %s, do not edit */\n'
+           % source(src)]
+    out.append(c_array('_sensor_names', build([s[2] for s in sensors])))
+    out.append(c_array('_sensor_uuids', build([s[1] for s in sensors])))
+    out.append(c_array('_station_names', build([s[0] for s in stations])))
+    return '\n'.join(out)
+
+
+def decoder_module(src, stations, sensors):
+    out = ['// generated by topology.py from %s, do not edit\n'
+           % source(src)]
+    out.append('/**')
+    out.append(' * Sensors of the stations, in the order of their compact index')
+    out.append(' */')
+    out.append('module.exports = [')
+    for _, uuid, name, kind, _ in sensors:
+        out.append('  { sensorID: "%s", sensorName: "%s", sensorType: "%s" },'
+                   % (uuid, name, kind))
+    out.append('];')
+    return '\n'.join(out) + '\n'
+
+
+OUTPUTS = {
+    'index': index_header,
+    'decoder': decoder_module,
+}
+
+
+def main(argv):
+    check = len(argv) > 1 and argv[1] == '--check'
+    if check:
+        argv = argv[:1] + argv[2:]
+    if len(argv) != 4 or argv[1] not in OUTPUTS:
+        sys.exit('usage: %s [--check] <index|decoder> <topology.def> <output>'
+                 % argv[0])
+
+    stations, sensors = parse(argv[2])
+    text = OUTPUTS[argv[1]](argv[2], stations, sensors)
+
+    if check:
+        try:
+            with open(argv[3]) as f:
+                current = f.read()
+        except OSError:
+            current = None
+        if current != text:
+            sys.exit('%s is out of date with %s, regenerate it with %s %s'
+                     % (argv[3], source(argv[2]), os.path.basename(argv[0]),
+                        argv[1]))
+        return
+
+    with open(argv[3], 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    main(sys.argv)
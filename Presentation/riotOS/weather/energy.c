@@ -0,0 +1,116 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Per state energy accounting
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "irq.h"
+#include "xtimer.h"
+
+#include "energy.h"
+
+/* uA * us in one nAh */
+#define UAUS_PER_NAH        (3600000ULL)
+
+static const uint32_t _current_ua[ENERGY_STATE_NUMOF] = {
+    [ENERGY_STATE_IDLE] = ENERGY_CURRENT_IDLE_UA,
+    [ENERGY_STATE_STOP] = ENERGY_CURRENT_STOP_UA,
+    [ENERGY_STATE_SENSE] = ENERGY_CURRENT_SENSE_UA,
+    [ENERGY_STATE_TX] = ENERGY_CURRENT_TX_UA,
+};
+
+static const char *_names[ENERGY_STATE_NUMOF] = {
+    [ENERGY_STATE_IDLE] = "idle",
+    [ENERGY_STATE_STOP] = "stop",
+    [ENERGY_STATE_SENSE] = "sense",
+    [ENERGY_STATE_TX] = "tx",
+};
+
+static uint64_t _time_us[ENERGY_STATE_NUMOF];
+static energy_state_t _state = ENERGY_STATE_IDLE;
+static uint64_t _since;
+static uint32_t _cycles;
+
+/* must be called with interrupts disabled */
+static void _account(uint64_t now)
+{
+    _time_us[_state] += now - _since;
+    _since = now;
+}
+
+energy_state_t energy_enter(energy_state_t state)
+{
+    unsigned irq = irq_disable();
+    energy_state_t prev = _state;
+
+    _account(xtimer_now_usec64());
+    _state = state;
+    irq_restore(irq);
+
+    return prev;
+}
+
+void energy_cycle(void)
+{
+    unsigned irq = irq_disable();
+    _cycles++;
+    irq_restore(irq);
+}
+
+void energy_reset(void)
+{
+    unsigned irq = irq_disable();
+    for (unsigned i = 0; i < ENERGY_STATE_NUMOF; i++) {
+        _time_us[i] = 0;
+    }
+    _cycles = 0;
+    _since = xtimer_now_usec64();
+    irq_restore(irq);
+}
+
+static void _print_uah(uint64_t nah)
+{
+    printf("%" PRIu32 ".%03" PRIu32 " uAh", (uint32_t)(nah / 1000),
+           (uint32_t)(nah % 1000));
+}
+
+void energy_print(void)
+{
+    uint64_t time_us[ENERGY_STATE_NUMOF];
+    uint64_t total_nah = 0;
+    uint32_t cycles;
+
+    unsigned irq = irq_disable();
+    _account(xtimer_now_usec64());
+    for (unsigned i = 0; i < ENERGY_STATE_NUMOF; i++) {
+        time_us[i] = _time_us[i];
+    }
+    cycles = _cycles;
+    irq_restore(irq);
+
+    for (unsigned i = 0; i < ENERGY_STATE_NUMOF; i++) {
+        uint64_t nah = time_us[i] * _current_ua[i] / UAUS_PER_NAH;
+        total_nah += nah;
+        printf("%-6s %10" PRIu32 " ms  ", _names[i], (uint32_t)(time_us[i] / 1000));
+        _print_uah(nah);
+        puts("");
+    }
+
+    printf("total  ");
+    _print_uah(total_nah);
+    printf(" over %" PRIu32 " cycles", cycles);
+    if (cycles) {
+        printf(", ");
+        _print_uah(total_nah / cycles);
+        printf(" per cycle");
+    }
+    puts("");
+}
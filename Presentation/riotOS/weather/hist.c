@@ -0,0 +1,81 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Fixed size histogram of durations
+ */
+
+#include <string.h>
+
+#include "hist.h"
+
+/* values below HIST_SUB_BUCKETS get a bucket each, then every power of two
+ * 2^msb is split by the HIST_SUB_BUCKETS following bits */
+static unsigned _bucket(uint32_t value)
+{
+    if (value < HIST_SUB_BUCKETS) {
+        return value;
+    }
+
+    unsigned msb = 31 - __builtin_clz(value);
+    return (msb - 2) * HIST_SUB_BUCKETS +
+           ((value >> (msb - 3)) & (HIST_SUB_BUCKETS - 1));
+}
+
+/* largest value falling into bucket b */
+static uint32_t _upper(unsigned b)
+{
+    if (b < HIST_SUB_BUCKETS) {
+        return b;
+    }
+
+    unsigned shift = b / HIST_SUB_BUCKETS - 1;
+    uint64_t next = (uint64_t)(HIST_SUB_BUCKETS + b % HIST_SUB_BUCKETS + 1) << shift;
+    return (uint32_t)(next - 1);
+}
+
+void hist_init(hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT32_MAX;
+}
+
+void hist_add(hist_t *h, uint32_t value)
+{
+    h->buckets[_bucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+uint32_t hist_percentile(const hist_t *h, unsigned percent)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+
+    /* rank of the value, rounded up so p100 is the last one */
+    uint64_t rank = ((uint64_t)h->count * percent + 99) / 100;
+    uint64_t seen = 0;
+
+    if (rank == 0) {
+        return h->min;
+    }
+    for (unsigned b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint32_t upper = _upper(b);
+            return (upper < h->max) ? upper : h->max;
+        }
+    }
+    return h->max;
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Streaming summary of the readings of a sensor
+ *
+ * Minimum, maximum, mean and variance of a window of readings are updated
+ * with every reading using Welford's method, in constant memory whatever the
+ * number of readings. The mean is kept as a fixed point number with
+ * AGGR_FRAC fractional bits, the sum of the squared deviations from the mean
+ * with AGGR_FRAC fractional bits as well, so no floating point is needed and
+ * the rounding error stays far below the resolution of a reading.
+ */
+
+#ifndef AGGR_H
+#define AGGR_H
+
+#include <stdint.h>
+
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Fractional bits of the running mean and sum of squares
+ */
+#define AGGR_FRAC           (16U)
+
+/**
+ * @brief   Running summary of a window of readings
+ */
+typedef struct {
+    uint32_t count;         /**< number of readings in the window */
+    weather_value_t min;    /**< smallest reading */
+    weather_value_t max;    /**< largest reading */
+    int32_t mean;           /**< mean, in 2^-AGGR_FRAC tenths */
+    uint64_t m2;            /**< sum of the squared deviations from the mean,
+                                 in 2^-AGGR_FRAC tenths squared */
+} aggr_t;
+
+/**
+ * @brief   Start an empty window
+ */
+void aggr_init(aggr_t *a);
+
+/**
+ * @brief   Add a reading to the window
+ */
+void aggr_add(aggr_t *a, weather_value_t value);
+
+/**
+ * @brief   Mean of the window, rounded to the resolution of a reading
+ *
+ * @return  the mean, 0 for an empty window
+ */
+weather_value_t aggr_mean(const aggr_t *a);
+
+/**
+ * @brief   Population standard deviation of the window, rounded to the
+ *          resolution of a reading
+ *
+ * @return  the standard deviation, 0 for less than two readings
+ */
+weather_value_t aggr_stddev(const aggr_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AGGR_H */
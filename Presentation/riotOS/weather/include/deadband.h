@@ -0,0 +1,132 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Report-by-exception policy of a sensor
+ *
+ * The scheduled uplink of a sensor is only sent when its reading left the
+ * deadband around the last reported one, or when nothing was reported for
+ * the maximum silence interval, which makes it a heartbeat. The deadband is
+ * the larger of an absolute width and a share of the last reported value.
+ *
+ * Optionally a sample that changed faster than a given rate, and left the
+ * deadband, is reported at once without waiting for the next uplink.
+ */
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <stdint.h>
+
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Default longest time without a report, in seconds
+ */
+#ifndef DEADBAND_SILENCE_DEFAULT
+#define DEADBAND_SILENCE_DEFAULT    (3600U)
+#endif
+
+/**
+ * @brief   Policy of a sensor, a field of 0 disables its check
+ *
+ * With both widths 0 every uplink is sent.
+ */
+typedef struct {
+    uint16_t width;         /**< absolute half width, in tenths */
+    uint16_t share;         /**< half width relative to the last report, in
+                                 per mille of its magnitude */
+    uint32_t silence;       /**< longest time without a report, in seconds */
+    uint16_t rate;          /**< change reported at once, in tenths per minute */
+    uint16_t wrap;          /**< full turn of a circular measure, in tenths,
+                                 0 for a linear one */
+} deadband_cfg_t;
+
+/**
+ * @brief   Why a reading is reported
+ */
+typedef enum {
+    DEADBAND_SKIP,          /**< not reported */
+    DEADBAND_FIRST,         /**< nothing was reported yet */
+    DEADBAND_CHANGE,        /**< the reading left the deadband */
+    DEADBAND_HEARTBEAT,     /**< the maximum silence was reached */
+    DEADBAND_RATE,          /**< the reading changed too fast */
+} deadband_reason_t;
+
+/**
+ * @brief   State of the policy of a sensor
+ */
+typedef struct {
+    deadband_cfg_t cfg;     /**< policy */
+    weather_value_t last;   /**< last reported reading */
+    weather_value_t prev;   /**< previous sample */
+    uint32_t last_time;     /**< time of the last report, in seconds */
+    uint32_t prev_time;     /**< time of the previous sample, in seconds */
+    uint32_t reported;      /**< number of reports */
+    uint32_t suppressed;    /**< number of uplinks skipped */
+    uint8_t flags;          /**< which of last and prev are set */
+} deadband_t;
+
+/**
+ * @brief   Get the default policy for a kind of measure
+ *
+ * The widths are about twice the noise of a typical sensor of the kind and
+ * no rate trigger is set. Wind directions wrap at 360 degrees.
+ */
+void deadband_default(deadband_cfg_t *cfg, weather_kind_t kind);
+
+/**
+ * @brief   Start the policy, nothing reported yet
+ */
+void deadband_init(deadband_t *d, const deadband_cfg_t *cfg);
+
+/**
+ * @brief   Decide whether a scheduled uplink is sent
+ *
+ * A skipped uplink is counted as suppressed.
+ *
+ * @param[in]  d        policy state
+ * @param[in]  now      current time, in seconds
+ * @param[in]  value    latest reading
+ *
+ * @return  why the uplink is sent, DEADBAND_SKIP if it is not
+ */
+deadband_reason_t deadband_check(deadband_t *d, uint32_t now,
+                                 weather_value_t value);
+
+/**
+ * @brief   Look at a new sample for the rate trigger
+ *
+ * @param[in]  d        policy state
+ * @param[in]  now      current time, in seconds
+ * @param[in]  value    sample
+ *
+ * @return  DEADBAND_RATE if the sample must be reported at once
+ * @return  DEADBAND_SKIP otherwise
+ */
+deadband_reason_t deadband_sample(deadband_t *d, uint32_t now,
+                                  weather_value_t value);
+
+/**
+ * @brief   Record a report, the deadband is now centered on @p value
+ */
+void deadband_reported(deadband_t *d, uint32_t now, weather_value_t value);
+
+/**
+ * @brief   Name of a reason, for the logs
+ */
+const char *deadband_reason_str(deadband_reason_t reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEADBAND_H */
@@ -0,0 +1,83 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Per state energy accounting
+ *
+ * The application reports the state it is in, the time spent in every
+ * state is multiplied by the typical current drawn in it to estimate the
+ * charge used. The currents are estimates for a b-l072z-lrwan1 with a
+ * HTS221, override them for other hardware.
+ */
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name    Typical current drawn in every state, in uA
+ * @{
+ */
+#ifndef ENERGY_CURRENT_IDLE_UA
+#define ENERGY_CURRENT_IDLE_UA      (1500U)     /**< MCU in sleep, peripherals on */
+#endif
+#ifndef ENERGY_CURRENT_STOP_UA
+#define ENERGY_CURRENT_STOP_UA      (5U)        /**< MCU in stop, sensor off */
+#endif
+#ifndef ENERGY_CURRENT_SENSE_UA
+#define ENERGY_CURRENT_SENSE_UA     (3500U)     /**< MCU running, I2C transfer */
+#endif
+#ifndef ENERGY_CURRENT_TX_UA
+#define ENERGY_CURRENT_TX_UA        (45000U)    /**< radio transmitting at 14 dBm */
+#endif
+/** @} */
+
+/**
+ * @brief   States accounted
+ */
+typedef enum {
+    ENERGY_STATE_IDLE,      /**< waiting, MCU kept in a light sleep */
+    ENERGY_STATE_STOP,      /**< waiting, MCU in its deepest usable state */
+    ENERGY_STATE_SENSE,     /**< reading the sensors */
+    ENERGY_STATE_TX,        /**< sending an uplink */
+    ENERGY_STATE_NUMOF,
+} energy_state_t;
+
+/**
+ * @brief   Switch to @p state, the time since the last switch is accounted
+ *          to the previous state
+ *
+ * @return  the previous state
+ */
+energy_state_t energy_enter(energy_state_t state);
+
+/**
+ * @brief   Count a completed duty cycle (e.g. an uplink period)
+ */
+void energy_cycle(void);
+
+/**
+ * @brief   Clear all the counters
+ */
+void energy_reset(void);
+
+/**
+ * @brief   Print the time and charge spent in every state, and the charge
+ *          per cycle
+ */
+void energy_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENERGY_H */
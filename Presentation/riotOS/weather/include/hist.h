@@ -0,0 +1,80 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Fixed size histogram of durations
+ *
+ * Durations are counted in log-linear buckets: every power of two is split
+ * into HIST_SUB_BUCKETS buckets, so a percentile is known within 12.5 % of
+ * its value over the whole uint32_t range, with a constant memory footprint.
+ */
+
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Buckets every power of two is split into
+ */
+#define HIST_SUB_BUCKETS    (8U)
+
+/**
+ * @brief   Number of buckets of a histogram
+ */
+#define HIST_BUCKETS        (30U * HIST_SUB_BUCKETS)
+
+/**
+ * @brief   A histogram
+ */
+typedef struct {
+    uint32_t buckets[HIST_BUCKETS]; /**< counts */
+    uint32_t count;                 /**< number of values added */
+    uint32_t min;                   /**< smallest value added */
+    uint32_t max;                   /**< largest value added */
+    uint64_t sum;                   /**< sum of the values added */
+} hist_t;
+
+/**
+ * @brief   Empty a histogram
+ */
+void hist_init(hist_t *h);
+
+/**
+ * @brief   Add a value
+ */
+void hist_add(hist_t *h, uint32_t value);
+
+/**
+ * @brief   Get a percentile
+ *
+ * @param[in]  h        histogram
+ * @param[in]  percent  percentile, 0 to 100
+ *
+ * @return  upper bound of the bucket the percentile falls in, clamped to the
+ *          largest value added
+ * @return  0 if the histogram is empty
+ */
+uint32_t hist_percentile(const hist_t *h, unsigned percent);
+
+/**
+ * @brief   Get the mean of the values added, 0 if empty
+ */
+static inline uint32_t hist_mean(const hist_t *h)
+{
+    return h->count ? (uint32_t)(h->sum / h->count) : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HIST_H */
@@ -0,0 +1,84 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Sequence numbered message IDs
+ *
+ * A message ID is the node ID, a boot epoch and a counter incremented for
+ * every message, written "node:epoch:counter" in the JSON payloads. The
+ * receiver drops a message whose ID it has seen, a retransmission, and finds
+ * the messages lost in the gaps of the counter of each node and epoch.
+ *
+ * With periph_eeprom the counter keeps growing across reboots and the epoch
+ * counts the boots. To spare the EEPROM the counter is not written for
+ * every message: a lease of MSGID_LEASE values is reserved at a time, a
+ * reboot skips what was left of it. Without EEPROM the counter starts from
+ * 0 and the epoch is given by the application, e.g. the time of boot.
+ */
+
+#ifndef MSGID_H
+#define MSGID_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Counter values reserved in the EEPROM at a time
+ */
+#ifndef MSGID_LEASE
+#define MSGID_LEASE             (256U)
+#endif
+
+/**
+ * @brief   Offset in the EEPROM of the counter, after the station stored by
+ *          the registry
+ */
+#ifndef MSGID_EEPROM_START
+#define MSGID_EEPROM_START      (288U)
+#endif
+
+/**
+ * @brief   Longest message ID written by payload_append_msgid(), node ID
+ *          excluded
+ */
+#define MSGID_MAXLEN            (22U)
+
+/**
+ * @brief   ID of a message
+ */
+typedef struct {
+    const char *node;           /**< ID of the node */
+    uint32_t epoch;             /**< boot epoch */
+    uint32_t seq;               /**< counter of the node in the epoch */
+} msgid_t;
+
+/**
+ * @brief   Start the message IDs of this boot
+ *
+ * @param[in]  node     ID of the node, must stay valid
+ * @param[in]  epoch    boot epoch, ignored with periph_eeprom
+ */
+void msgid_init(const char *node, uint32_t epoch);
+
+/**
+ * @brief   Take the ID of a new message
+ */
+void msgid_next(msgid_t *id);
+
+/**
+ * @brief   Get the ID the next message will take, without taking it
+ */
+void msgid_peek(msgid_t *id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSGID_H */
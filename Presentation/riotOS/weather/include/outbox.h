@@ -0,0 +1,182 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Store-and-forward outbox of the uplink frames
+ *
+ * Frames that could not be sent, because of the duty cycle, a busy MAC or a
+ * lost gateway, are kept in a statically sized ring buffer together with
+ * the time they were queued. Once the link is back they are replayed oldest
+ * first, several of them packed into a single batch frame when they fit.
+ * When the ring is full the oldest frames are dropped, so the memory used is
+ * bounded whatever the length of the outage. Like the readings of tsbuf,
+ * frames are only removed with outbox_consume() once actually sent.
+ *
+ * Batch frame (type PAYLOAD_FRAME_BATCH), multi byte fields in network byte
+ * order:
+ *
+ *     | type (1) | age (2) | length (1) | frame | age (2) | length (1) | ...
+ *
+ * age is the number of seconds the frame waited in the outbox, saturating
+ * to 65535, so the receiver can date the readings it carries.
+ *
+ * With periph_eeprom the ring can be mirrored to the EEPROM, every change is
+ * written through so the frames survive a reset. The time a frame was
+ * queued is not kept across a reset, restored frames count as queued at
+ * boot.
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Bytes of frames kept by an outbox, headers included
+ */
+#ifndef OUTBOX_SIZE
+#define OUTBOX_SIZE             (512U)
+#endif
+
+/**
+ * @brief   Bytes used in the outbox by each frame on top of its data
+ */
+#define OUTBOX_FRAME_HEADER_LEN (6U)
+
+/**
+ * @brief   Bytes added by a batch frame, plus OUTBOX_BATCH_ENTRY_LEN per
+ *          frame packed
+ */
+#define OUTBOX_BATCH_HEADER_LEN (1U)
+
+/**
+ * @brief   Bytes preceding every frame packed into a batch frame
+ */
+#define OUTBOX_BATCH_ENTRY_LEN  (3U)
+
+/**
+ * @brief   Offset in the EEPROM of the copy of the outbox, after the station
+ *          stored by the registry
+ */
+#ifndef OUTBOX_EEPROM_START
+#define OUTBOX_EEPROM_START     (512U)
+#endif
+
+/**
+ * @brief   Ring buffer of frames waiting for the link
+ */
+typedef struct {
+    uint8_t data[OUTBOX_SIZE];  /**< frames, each after its header */
+    uint16_t head;              /**< position of the oldest frame */
+    uint16_t used;              /**< bytes in use */
+    uint16_t count;             /**< frames waiting */
+    uint32_t queued;            /**< frames accepted */
+    uint32_t replayed;          /**< frames sent from the outbox */
+    uint32_t dropped;           /**< frames overwritten while full */
+#if defined(MODULE_PERIPH_EEPROM) || defined(DOXYGEN)
+    uint32_t eeprom;            /**< position of the copy, 0 if none */
+#endif
+} outbox_t;
+
+/**
+ * @brief   Initialize an empty outbox, kept in RAM only
+ */
+void outbox_init(outbox_t *ob);
+
+/**
+ * @brief   Queue a copy of a frame, dropping the oldest ones if needed
+ *
+ * @param[in]  ob       outbox
+ * @param[in]  time     current time in seconds, any monotonic time base
+ * @param[in]  data     frame
+ * @param[in]  len      length of @p data
+ *
+ * @return  0 on success
+ * @return  -EMSGSIZE if the frame can never fit into the outbox
+ */
+int outbox_push(outbox_t *ob, uint32_t time, const void *data, size_t len);
+
+/**
+ * @brief   Number of frames waiting
+ */
+static inline unsigned outbox_count(const outbox_t *ob)
+{
+    return ob->count;
+}
+
+/**
+ * @brief   Copy the oldest frame, the outbox itself is not modified
+ *
+ * @param[in]  ob       outbox
+ * @param[out] buf      destination of the frame
+ * @param[in]  size     size of @p buf
+ *
+ * @return  length of the frame
+ * @return  -ENODATA if @p ob is empty
+ * @return  -ENOBUFS if the frame does not fit into @p buf
+ */
+int outbox_peek(const outbox_t *ob, void *buf, size_t size);
+
+/**
+ * @brief   Pack the oldest frames into a batch frame
+ *
+ * As many frames as fit into @p size bytes are packed, in order, the outbox
+ * itself is not modified.
+ *
+ * @param[in]  ob       outbox
+ * @param[out] buf      destination of the batch frame
+ * @param[in]  size     size of @p buf
+ * @param[in]  now      current time, in the time base of outbox_push()
+ * @param[out] packed   number of frames packed
+ *
+ * @return  length of the batch frame
+ * @return  -ENODATA if @p ob is empty
+ * @return  -ENOBUFS if the oldest frame does not fit into @p buf
+ */
+int outbox_batch(const outbox_t *ob, uint8_t *buf, size_t size, uint32_t now,
+                 unsigned *packed);
+
+/**
+ * @brief   Remove the @p n oldest frames, after they were sent
+ */
+void outbox_consume(outbox_t *ob, unsigned n);
+
+/**
+ * @brief   Remove all the frames, the counters are kept
+ */
+void outbox_clear(outbox_t *ob);
+
+#if defined(MODULE_PERIPH_EEPROM) || defined(DOXYGEN)
+/**
+ * @brief   Mirror the outbox to the EEPROM
+ *
+ * The frames of a valid copy found at @p pos are restored, with @p now as
+ * the time they were queued, otherwise the copy is initialized with the
+ * frames of @p ob.
+ *
+ * @param[in]  ob       outbox
+ * @param[in]  pos      offset of the copy in the EEPROM, not 0
+ * @param[in]  now      current time, in the time base of outbox_push()
+ *
+ * @return  number of frames restored
+ * @return  -EIO if the EEPROM could not be written
+ * @return  -EBADMSG if the frames of the copy were damaged, the outbox
+ *          starts empty
+ */
+int outbox_attach(outbox_t *ob, uint32_t pos, uint32_t now);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OUTBOX_H */
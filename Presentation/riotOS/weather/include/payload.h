@@ -0,0 +1,376 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Bounded, single pass payload writer
+ *
+ * The writer appends to a caller supplied buffer while keeping track of the
+ * current length, so no call ever rescans what was already written and no
+ * heap memory is used. Writes that do not fit are truncated and remembered,
+ * payload_finish() then reports the error.
+ */
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aggr.h"
+#include "msgid.h"
+#include "rain.h"
+#include "wind.h"
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Size of a buffer able to hold a JSON sensor payload
+ */
+#define PAYLOAD_JSON_MAXLEN     (250U)
+
+/**
+ * @brief   Size of a buffer able to hold a JSON summary payload
+ */
+#define PAYLOAD_SUMMARY_JSON_MAXLEN (320U)
+
+/**
+ * @brief   Type of a binary frame, carried in its first byte
+ *
+ * A JSON payload always starts with '{', so the receiver can tell both
+ * encodings apart from the first byte.
+ */
+#define PAYLOAD_FRAME_READING   (0x01)
+
+/**
+ * @brief   Length of a PAYLOAD_FRAME_READING frame
+ *
+ * Layout, multi byte fields in network byte order:
+ *
+ *     | type (1) | sequence number (2) | sensor index (1) | value (2) |
+ *
+ * The value is a signed integer in tenths of the unit of the sensor.
+ */
+#define PAYLOAD_FRAME_READING_LEN   (6U)
+
+/**
+ * @brief   Type of a binary frame carrying all the readings of a station
+ */
+#define PAYLOAD_FRAME_STATION   (0x02)
+
+/**
+ * @brief   Maximum length of a PAYLOAD_FRAME_STATION frame
+ *
+ *     | type (1) | sequence number (2) | first sensor ID (1) | values (2 each) |
+ *
+ * The values follow the order of weatherStation::sensors, the k-th value
+ * belongs to the sensor with compact ID first sensor ID + k. The number of
+ * values follows from the length of the frame.
+ */
+#define PAYLOAD_FRAME_STATION_LEN   (4U + 2U * WEATHER_SENSORS_NUMOF)
+
+/**
+ * @brief   Type of a binary frame carrying a compressed block of readings of
+ *          one sensor, see tsbuf.h for its layout
+ */
+#define PAYLOAD_FRAME_SERIES    (0x03)
+
+/**
+ * @brief   Type of a binary frame packing frames replayed from the outbox,
+ *          see outbox.h for its layout
+ */
+#define PAYLOAD_FRAME_BATCH     (0x04)
+
+/**
+ * @brief   Type of a binary frame carrying the summary of a window of readings
+ *          of one sensor
+ */
+#define PAYLOAD_FRAME_SUMMARY   (0x05)
+
+/**
+ * @brief   Length of a PAYLOAD_FRAME_SUMMARY frame
+ *
+ *     | type (1) | sequence number (2) | sensor index (1) | count (2) |
+ *     | min (2) | max (2) | mean (2) | standard deviation (2) |
+ *
+ * The count saturates at 65535, the other fields are signed integers in
+ * tenths of the unit of the sensor.
+ */
+#define PAYLOAD_FRAME_SUMMARY_LEN   (14U)
+
+/**
+ * @brief   Type of a binary frame carrying the wind vector summary of a window
+ */
+#define PAYLOAD_FRAME_WIND      (0x06)
+
+/**
+ * @brief   Length of a PAYLOAD_FRAME_WIND frame
+ *
+ *     | type (1) | sequence number (2) | direction sensor index (1) |
+ *     | speed sensor index (1) | count (2) | direction (2) | speed (2) |
+ *     | gust (2) |
+ *
+ * The count saturates at 65535, the direction is the vector mean in tenths
+ * of degree, speed and gust are in tenths of the unit of the speed sensor.
+ */
+#define PAYLOAD_FRAME_WIND_LEN  (13U)
+
+/**
+ * @brief   Type of a binary frame carrying the rain counted by the gauge
+ */
+#define PAYLOAD_FRAME_RAIN      (0x07)
+
+/**
+ * @brief   Length of a PAYLOAD_FRAME_RAIN frame
+ *
+ *     | type (1) | sequence number (2) | sensor index (1) | tips (2) |
+ *     | span (2) | total (2) | intensity (2) | peak (2) |
+ *
+ * Tips and span, in seconds, saturate at 65535. The total is in tenths of
+ * mm, the mean and peak intensities in tenths of mm/h.
+ */
+#define PAYLOAD_FRAME_RAIN_LEN  (14U)
+
+/**
+ * @brief   Size of a buffer able to hold a JSON station payload
+ */
+#define PAYLOAD_STATION_JSON_MAXLEN (480U)
+
+/**
+ * @brief   Encodings available for the uplink
+ */
+typedef enum {
+    PAYLOAD_ENCODING_JSON,      /**< human readable JSON document */
+    PAYLOAD_ENCODING_BINARY,    /**< compact binary frame */
+} payload_encoding_t;
+
+/**
+ * @brief   Payload writer state
+ */
+typedef struct {
+    char *buf;          /**< destination buffer */
+    size_t size;        /**< size of @p buf, including the terminating '\0' */
+    size_t len;         /**< number of bytes written so far */
+    bool overflow;      /**< set once a write did not fit */
+} payload_t;
+
+/**
+ * @brief   Start a new payload in @p buf
+ */
+void payload_init(payload_t *p, char *buf, size_t size);
+
+/**
+ * @brief   Append @p len bytes of @p data
+ */
+void payload_append_n(payload_t *p, const char *data, size_t len);
+
+/**
+ * @brief   Append the '\0' terminated string @p str
+ */
+void payload_append(payload_t *p, const char *str);
+
+/**
+ * @brief   Append a single character
+ */
+void payload_append_char(payload_t *p, char c);
+
+/**
+ * @brief   Append a fixed point number
+ *
+ * @param[in] p         payload writer
+ * @param[in] value     number scaled by 10^@p decimals
+ * @param[in] decimals  number of fractional digits in @p value, at most 9
+ */
+void payload_append_fixed(payload_t *p, int32_t value, unsigned decimals);
+
+/**
+ * @brief   Append a message ID, "node:epoch:counter"
+ */
+void payload_append_msgid(payload_t *p, const msgid_t *id);
+
+/**
+ * @brief   Terminate the payload
+ *
+ * @return  length of the payload, without the terminating '\0'
+ * @return  -ENOBUFS if the payload did not fit into the buffer
+ */
+int payload_finish(payload_t *p);
+
+/**
+ * @brief   Build the JSON document describing a reading of @p s
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  s        sensor to describe
+ * @param[in]  id       ID of the message
+ *
+ * @return  length of the payload
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_sensor_json(char *buf, size_t size, const sensor *s,
+                        const msgid_t *id);
+
+/**
+ * @brief   Build the JSON document summarizing a window of readings of @p s
+ *
+ * The document is the one of payload_sensor_json() with the mean as value,
+ * followed by the min, max, standard deviation and count of the window.
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  s        sensor to describe
+ * @param[in]  a        summary of the window
+ * @param[in]  id       ID of the message
+ *
+ * @return  length of the payload
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_summary_json(char *buf, size_t size, const sensor *s,
+                         const aggr_t *a, const msgid_t *id);
+
+/**
+ * @brief   Build the JSON document carrying the rain counted by the gauge
+ *
+ * The document is the one of payload_sensor_json() with the mean intensity
+ * as value, followed by the total, peak intensity, tips and span.
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  s        rain sensor
+ * @param[in]  r        rain since the previous report
+ * @param[in]  id       ID of the message
+ *
+ * @return  length of the payload
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_rain_json(char *buf, size_t size, const sensor *s,
+                      const rain_report_t *r, const msgid_t *id);
+
+/**
+ * @brief   Build the JSON document carrying the wind vector summary of a
+ *          window
+ *
+ * The document has the layout of payload_station_json(), with the mean
+ * direction and speed as readings and the gust and count added.
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  station  name of the station
+ * @param[in]  dir      wind direction sensor
+ * @param[in]  speed    wind speed sensor
+ * @param[in]  w        summary of the window
+ * @param[in]  id       ID of the message
+ *
+ * @return  length of the payload
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_wind_json(char *buf, size_t size, const char *station,
+                      const sensor *dir, const sensor *speed, const wind_t *w,
+                      const msgid_t *id);
+
+/**
+ * @brief   Build the JSON document carrying the readings of all the sensors
+ *          of @p st
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  st       station to describe
+ * @param[in]  id       ID of the message
+ *
+ * @return  length of the payload
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_station_json(char *buf, size_t size, const weatherStation *st,
+                         const msgid_t *id);
+
+/**
+ * @brief   Build a binary frame carrying a single reading
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  index    compact index of the sensor
+ * @param[in]  value    reading, in tenths of the unit of the sensor
+ * @param[in]  seq      sequence number of the frame
+ *
+ * @return  length of the frame, PAYLOAD_FRAME_READING_LEN
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_reading_frame(uint8_t *buf, size_t size, uint8_t index,
+                          weather_value_t value, uint16_t seq);
+
+/**
+ * @brief   Build a binary frame carrying the readings of all the sensors of a
+ *          station
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  first    compact ID of the first sensor of the station
+ * @param[in]  values   readings, in tenths
+ * @param[in]  numof    number of readings, at most WEATHER_SENSORS_NUMOF
+ * @param[in]  seq      sequence number of the frame
+ *
+ * @return  length of the frame
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_station_frame(uint8_t *buf, size_t size, uint8_t first,
+                          const weather_value_t *values, unsigned numof,
+                          uint16_t seq);
+
+/**
+ * @brief   Build a binary frame carrying the summary of a window of readings
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  index    compact index of the sensor
+ * @param[in]  a        summary of the window
+ * @param[in]  seq      sequence number of the frame
+ *
+ * @return  length of the frame, PAYLOAD_FRAME_SUMMARY_LEN
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_summary_frame(uint8_t *buf, size_t size, uint8_t index,
+                          const aggr_t *a, uint16_t seq);
+
+/**
+ * @brief   Build a binary frame carrying the wind vector summary of a window
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  dir      compact index of the wind direction sensor
+ * @param[in]  speed    compact index of the wind speed sensor
+ * @param[in]  w        summary of the window
+ * @param[in]  seq      sequence number of the frame
+ *
+ * @return  length of the frame, PAYLOAD_FRAME_WIND_LEN
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_wind_frame(uint8_t *buf, size_t size, uint8_t dir, uint8_t speed,
+                       const wind_t *w, uint16_t seq);
+
+/**
+ * @brief   Build a binary frame carrying the rain counted by the gauge
+ *
+ * @param[out] buf      destination buffer
+ * @param[in]  size     size of @p buf
+ * @param[in]  index    compact index of the rain sensor
+ * @param[in]  r        rain since the previous report
+ * @param[in]  seq      sequence number of the frame
+ *
+ * @return  length of the frame, PAYLOAD_FRAME_RAIN_LEN
+ * @return  -ENOBUFS if @p buf is too small
+ */
+int payload_rain_frame(uint8_t *buf, size_t size, uint8_t index,
+                       const rain_report_t *r, uint16_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAYLOAD_H */
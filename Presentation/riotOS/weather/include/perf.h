@@ -0,0 +1,90 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Time spent in the stages of the telemetry pipeline
+ *
+ * Every stage keeps the count, minimum, maximum and mean of its durations
+ * and a histogram with a bucket per power of two, small enough to keep one
+ * per stage on a microcontroller. The durations are CPU cycles from the DWT
+ * cycle counter on the Cortex-M cores that have one, microseconds from the
+ * xtimer elsewhere, e.g. on the Cortex-M0+ of the b-l072z-lrwan1 and on
+ * native, see perf_unit().
+ *
+ * A stage is timed by taking perf_now() before it and handing it to
+ * perf_stop() after it. Stages may be timed from several threads.
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Buckets of a histogram, bucket i counts the durations of i bits
+ */
+#define PERF_BUCKETS        (33U)
+
+/**
+ * @brief   Durations of a stage
+ */
+typedef struct {
+    const char *name;                   /**< name of the stage */
+    uint32_t count;                     /**< number of durations */
+    uint32_t min;                       /**< shortest duration */
+    uint32_t max;                       /**< longest duration */
+    uint64_t sum;                       /**< sum of the durations */
+    uint32_t buckets[PERF_BUCKETS];     /**< histogram */
+} perf_stage_t;
+
+/**
+ * @brief   Static initializer of a stage
+ */
+#define PERF_STAGE_INIT(n)  { .name = (n), .min = UINT32_MAX }
+
+/**
+ * @brief   Start the cycle counter, if the core has one
+ */
+void perf_init(void);
+
+/**
+ * @brief   Current time, in the unit of the durations
+ */
+uint32_t perf_now(void);
+
+/**
+ * @brief   Unit of the durations, "cycles" or "us"
+ */
+const char *perf_unit(void);
+
+/**
+ * @brief   Account the time since @p start to a stage
+ *
+ * @param[in]  s        stage
+ * @param[in]  start    perf_now() at the start of the stage
+ */
+void perf_stop(perf_stage_t *s, uint32_t start);
+
+/**
+ * @brief   Forget the durations of a stage
+ */
+void perf_reset(perf_stage_t *s);
+
+/**
+ * @brief   Print the statistics and the histogram of a stage
+ */
+void perf_print(const perf_stage_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_H */
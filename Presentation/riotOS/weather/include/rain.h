@@ -0,0 +1,93 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Tipping bucket rain gauge
+ *
+ * Every tip of the bucket closes a reed switch wired to a GPIO. The interrupt
+ * handler only counts the tip and keeps the shortest time between two tips,
+ * no thread is woken up, so the board sleeps through a downpour and no burst
+ * is missed between two polls. The telemetry collects the counts with
+ * rain_take(), once per uplink, as the rain fallen since the previous
+ * collection and its mean and peak intensity.
+ *
+ * The interrupt handler needs the periph_gpio_irq feature, without it
+ * rain_init() fails and nothing is counted.
+ */
+
+#ifndef RAIN_H
+#define RAIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "periph/gpio.h"
+
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Rain of a tip of the bucket, in micrometres
+ */
+#ifndef RAIN_TIP_UM
+#define RAIN_TIP_UM         (200U)
+#endif
+
+/**
+ * @brief   Edges closer than this to the previous tip are contact bounce
+ */
+#ifndef RAIN_DEBOUNCE_US
+#define RAIN_DEBOUNCE_US    (25U * 1000U)
+#endif
+
+/**
+ * @brief   Rain since the previous collection
+ */
+typedef struct {
+    uint32_t tips;              /**< tips of the bucket */
+    uint32_t span;              /**< time covered, in seconds */
+    weather_value_t total;      /**< rain fallen, in tenths of mm */
+    weather_value_t intensity;  /**< mean intensity, in tenths of mm/h */
+    weather_value_t peak;       /**< intensity between the two closest tips,
+                                     in tenths of mm/h */
+} rain_report_t;
+
+/**
+ * @brief   Start counting the tips of the gauge on @p pin
+ *
+ * @param[in]  pin      GPIO of the reed switch, closed to ground by a tip
+ *
+ * @return  0 on success
+ * @return  -ENOTSUP without the periph_gpio_irq feature
+ * @return  -EIO if the interrupt could not be set up
+ */
+int rain_init(gpio_t pin);
+
+/**
+ * @brief   Check whether the gauge is counting
+ */
+bool rain_is_active(void);
+
+/**
+ * @brief   Get the rain since the previous collection and start a new one
+ */
+void rain_take(rain_report_t *r);
+
+/**
+ * @brief   Get the rain since the previous collection, without starting a new
+ *          one
+ */
+void rain_peek(rain_report_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAIN_H */
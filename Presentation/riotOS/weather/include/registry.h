@@ -0,0 +1,168 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Constant registry of the stations and sensors
+ *
+ * The registry is compiled from the topology file of the application into
+ * constant tables, see topology.c. Every sensor is identified by a compact
+ * numeric ID, its position in registry_sensors, the sensors of a station are
+ * stored next to each other in the order of weatherStation::sensors. The
+ * binary frames carry the compact IDs in one byte, a topology has 256 sensors
+ * at most.
+ *
+ * Sensors are found by name or UUID and stations by name through hash
+ * indexes generated at build time from the same topology file by
+ * weather/dist/topology.py, see Makefile.registry. Every index has at least
+ * twice as many buckets as entries, so a lookup takes constant time
+ * independent of the size of the registry.
+ *
+ * The tables and the indexes live in flash, the registry uses no RAM.
+ *
+ * With periph_eeprom the station of the board can be stored in the EEPROM,
+ * so a single firmware image serves every station of the topology.
+ */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Offset in the EEPROM of the station of the board, after the
+ *          LoRaWAN configuration saved by semtech_loramac
+ */
+#ifndef REGISTRY_EEPROM_START
+#define REGISTRY_EEPROM_START   (256U)
+#endif
+
+/**
+ * @brief   Maximum length of a station name stored in the EEPROM, including
+ *          the terminating zero
+ */
+#ifndef REGISTRY_NAME_MAXLEN
+#define REGISTRY_NAME_MAXLEN    (16U)
+#endif
+
+/**
+ * @brief   A sensor of the registry
+ */
+typedef struct {
+    const char *ID;             /**< UUID of the sensor */
+    const char *sensorName;     /**< unique name */
+    const char *sensorType;     /**< type of measure */
+    uint16_t station;           /**< index of the station it belongs to */
+    uint8_t kind;               /**< a weather_kind_t */
+} registry_sensor_t;
+
+/**
+ * @brief   A station of the registry
+ */
+typedef struct {
+    const char *name;           /**< unique name */
+    uint16_t first;             /**< compact ID of its first sensor */
+    uint8_t numof;              /**< number of sensors */
+} registry_station_t;
+
+/**
+ * @name    Registry tables, compiled from the topology file
+ * @{
+ */
+extern const registry_station_t registry_stations[];
+extern const unsigned registry_stations_numof;
+extern const registry_sensor_t registry_sensors[];
+extern const unsigned registry_sensors_numof;
+/** @} */
+
+/**
+ * @brief   Check the tables and the lookup indexes
+ *
+ * @return  0 on success
+ * @return  -EOVERFLOW if the compact IDs do not fit in one byte
+ * @return  -EINVAL if the sensors of a station are not listed together, or
+ *          the indexes were generated from another topology
+ */
+int registry_init(void);
+
+/**
+ * @brief   Get a sensor by compact ID
+ *
+ * @return  the sensor, NULL if @p id is out of range
+ */
+const registry_sensor_t *registry_sensor(unsigned id);
+
+/**
+ * @brief   Get a station by index
+ *
+ * @return  the station, NULL if @p idx is out of range
+ */
+const registry_station_t *registry_station(unsigned idx);
+
+/**
+ * @brief   Find a sensor by name
+ *
+ * @return  compact ID of the sensor, -1 if not found
+ */
+int registry_sensor_by_name(const char *name);
+
+/**
+ * @brief   Find a sensor by UUID
+ *
+ * @return  compact ID of the sensor, -1 if not found
+ */
+int registry_sensor_by_uuid(const char *uuid);
+
+/**
+ * @brief   Find a sensor by name, UUID or compact ID written in decimal
+ *
+ * @return  compact ID of the sensor, -1 if not found
+ */
+int registry_sensor_find(const char *key);
+
+/**
+ * @brief   Find a station by name
+ *
+ * @return  index of the station, -1 if not found
+ */
+int registry_station_by_name(const char *name);
+
+#if defined(MODULE_PERIPH_EEPROM) || defined(DOXYGEN)
+/**
+ * @brief   Get the station of the board stored in the EEPROM
+ *
+ * The station is stored by name, so it stays valid when the topology changes.
+ *
+ * @return  index of the station
+ * @return  -ENOENT if no station, or a station unknown to the topology, is
+ *          stored
+ */
+int registry_station_load(void);
+
+/**
+ * @brief   Store the station of the board in the EEPROM
+ *
+ * @return  0 on success
+ * @return  -EINVAL if @p idx is out of range or its name too long
+ * @return  -EIO if the EEPROM could not be written
+ */
+int registry_station_save(unsigned idx);
+
+/**
+ * @brief   Forget the station of the board stored in the EEPROM
+ */
+void registry_station_erase(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REGISTRY_H */
@@ -0,0 +1,101 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Lock-free queue of timestamped sensor samples
+ *
+ * The queue hands the samples from the acquisition thread, its only
+ * producer, to the telemetry thread, its only consumer. Each side writes only
+ * its own index and reads the other one with acquire/release ordering, so
+ * neither side takes a lock or disables the interrupts, and a slow consumer
+ * never stalls the sampling: a sample pushed into a full queue is dropped and
+ * counted.
+ */
+
+#ifndef SAMPLEQ_H
+#define SAMPLEQ_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Samples held by a queue, must be a power of 2
+ */
+#ifndef SAMPLEQ_SIZE
+#define SAMPLEQ_SIZE        (32U)
+#endif
+
+#if (SAMPLEQ_SIZE & (SAMPLEQ_SIZE - 1)) != 0
+#error "SAMPLEQ_SIZE must be a power of 2"
+#endif
+
+/**
+ * @brief   Sample of a sensor
+ */
+typedef struct {
+    uint32_t time;          /**< time of the conversion, in milliseconds */
+    weather_kind_t kind;    /**< measure of the sample */
+    weather_value_t value;  /**< sample, in tenths of the unit */
+} sampleq_entry_t;
+
+/**
+ * @brief   Single producer, single consumer queue of samples
+ */
+typedef struct {
+    sampleq_entry_t buf[SAMPLEQ_SIZE];  /**< samples */
+    atomic_uint head;                   /**< next write, only the producer
+                                             moves it */
+    atomic_uint tail;                   /**< next read, only the consumer
+                                             moves it */
+    atomic_uint dropped;                /**< samples lost to a full queue */
+} sampleq_t;
+
+/**
+ * @brief   Start an empty queue
+ *
+ * Neither side may use the queue during the call.
+ */
+void sampleq_init(sampleq_t *q);
+
+/**
+ * @brief   Producer: add a sample
+ *
+ * @return  true on success
+ * @return  false if the queue is full, the sample is dropped
+ */
+bool sampleq_push(sampleq_t *q, const sampleq_entry_t *e);
+
+/**
+ * @brief   Consumer: take the oldest sample
+ *
+ * @return  true on success
+ * @return  false if the queue is empty
+ */
+bool sampleq_pop(sampleq_t *q, sampleq_entry_t *e);
+
+/**
+ * @brief   Number of samples waiting, exact only for the consumer
+ */
+unsigned sampleq_count(sampleq_t *q);
+
+/**
+ * @brief   Number of samples dropped since the queue was started
+ */
+unsigned sampleq_dropped(sampleq_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLEQ_H */
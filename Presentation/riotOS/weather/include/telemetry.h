@@ -0,0 +1,111 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Telemetry scheduler thread
+ *
+ * Every slot (usually a sensor) has its own sampling and uplink period. The
+ * thread sleeps until the earliest deadline and deadlines advance by whole
+ * periods from the time the slot was (re)started, so the cadence does not
+ * drift by the time spent sampling or sending. Missed deadlines are skipped
+ * instead of being caught up in a burst. The thread is controlled through
+ * messages, so start, stop and retune take effect immediately.
+ *
+ * The thread also runs a one-shot retry, e.g. of an uplink the duty cycle
+ * held back, whether the slots are scheduled or not.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Periods and deadlines of a slot
+ */
+typedef struct {
+    uint32_t sample_period;     /**< seconds between samples, 0 disables */
+    uint32_t uplink_period;     /**< seconds between uplinks, 0 disables */
+    uint64_t next_sample;       /**< next sampling deadline, in us */
+    uint64_t next_uplink;       /**< next uplink deadline, in us */
+} telemetry_slot_t;
+
+/**
+ * @brief   Actions run by the scheduler thread
+ */
+typedef struct {
+    void (*sample)(unsigned slot);  /**< take a sample of @p slot */
+    void (*uplink)(unsigned slot);  /**< send the data of @p slot */
+    void (*retry)(void);            /**< run once when telemetry_retry() is
+                                         due, may be NULL */
+} telemetry_cb_t;
+
+/**
+ * @brief   Start the (idle) scheduler thread
+ *
+ * @param[in] stack     stack of the thread
+ * @param[in] stacksize size of @p stack
+ * @param[in] prio      priority of the thread
+ * @param[in] slots     slot table, owned by the scheduler from now on
+ * @param[in] numof     number of entries in @p slots
+ * @param[in] cb        actions to run
+ *
+ * @return  PID of the scheduler thread
+ */
+kernel_pid_t telemetry_init(char *stack, int stacksize, uint8_t prio,
+                            telemetry_slot_t *slots, unsigned numof,
+                            const telemetry_cb_t *cb);
+
+/**
+ * @brief   Start scheduling, all deadlines are counted from now
+ */
+void telemetry_start(void);
+
+/**
+ * @brief   Stop scheduling
+ */
+void telemetry_stop(void);
+
+/**
+ * @brief   Check whether the scheduler is running
+ */
+bool telemetry_is_running(void);
+
+/**
+ * @brief   Change the periods of a slot, its deadlines restart from now
+ *
+ * @param[in] slot      slot to change
+ * @param[in] sample_s  seconds between samples, 0 disables sampling
+ * @param[in] uplink_s  seconds between uplinks, 0 disables the uplink
+ */
+void telemetry_set_periods(unsigned slot, uint32_t sample_s, uint32_t uplink_s);
+
+/**
+ * @brief   Run the retry action in @p delay_us, or earlier if a retry is
+ *          already due before
+ *
+ * @param[in] delay_us  microseconds before the retry
+ */
+void telemetry_retry(uint32_t delay_us);
+
+/**
+ * @brief   Get the periods of a slot
+ */
+void telemetry_get_periods(unsigned slot, uint32_t *sample_s, uint32_t *uplink_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,78 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Binary trace of the telemetry events
+ *
+ * TRACE() records an event, a static name and an integer argument, with the
+ * time it happened into a ring that keeps the latest TRACE_SIZE events. No
+ * text is formatted and nothing is written to the UART until trace_print()
+ * is called, typically from a shell command, so the timing of the traced
+ * code barely changes. Events can be recorded from interrupts.
+ *
+ * Without WEATHER_TRACE defined TRACE() expands to nothing and its arguments
+ * are not evaluated, a build without the trace pays nothing for it.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Events kept, the oldest ones are overwritten
+ */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE          (64U)
+#endif
+
+/**
+ * @brief   Record an event
+ *
+ * @param[in]  event    name of the event, must be a string literal
+ * @param[in]  arg      integer argument of the event
+ */
+#ifdef WEATHER_TRACE
+#define TRACE(event, arg)   trace_add(event, (int32_t)(arg))
+#else
+#define TRACE(event, arg)   do { (void)sizeof(arg); } while (0)
+#endif
+
+/**
+ * @brief   Recorded event
+ */
+typedef struct {
+    uint32_t time;          /**< time of the event, in microseconds */
+    const char *event;      /**< name of the event */
+    int32_t arg;            /**< argument of the event */
+} trace_entry_t;
+
+/**
+ * @brief   Record an event, use TRACE() instead
+ */
+void trace_add(const char *event, int32_t arg);
+
+/**
+ * @brief   Print the events kept, from the oldest, with the time elapsed
+ *          since the previous one
+ */
+void trace_print(void);
+
+/**
+ * @brief   Forget the events recorded so far
+ */
+void trace_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,123 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Time series ring buffer with compressed flushing
+ *
+ * Readings are stored raw in a statically sized ring buffer. When an uplink
+ * is due the oldest readings are packed into a compressed block, in the
+ * spirit of Facebook's Gorilla: timestamps are stored as delta-of-delta and
+ * values as the delta from the previous value, both with a variable length
+ * bit encoding. Readings are only removed with tsbuf_consume() once the
+ * block was actually sent, so a failed uplink loses nothing.
+ *
+ * Block layout (frame type PAYLOAD_FRAME_SERIES), multi byte fields in
+ * network byte order:
+ *
+ *     | type (1) | sensor index (1) | count (1) | age (4) | value (2) | bits |
+ *
+ * age is the number of seconds between the first reading and the creation
+ * of the block, value the first reading in tenths. For every further reading
+ * the bit stream (MSB first) holds the timestamp delta-of-delta D followed by
+ * the value delta V:
+ *
+ *     D == 0 -> '0'       D in [-64, 63]   -> '10'  + 7 bits
+ *     D in [-256, 255]    -> '110' + 9 bits, otherwise '111' + 32 bits
+ *     V == 0 -> '0'       V in [-8, 7]     -> '10'  + 4 bits
+ *     V in [-128, 127]    -> '110' + 8 bits, otherwise '111' + 17 bits
+ *
+ * The delta preceding the first reading is taken as 0.
+ */
+
+#ifndef TSBUF_H
+#define TSBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Number of readings kept by each buffer
+ */
+#ifndef TSBUF_SIZE
+#define TSBUF_SIZE              (32U)
+#endif
+
+/**
+ * @brief   Length of the header of a compressed block
+ */
+#define TSBUF_HEADER_LEN        (9U)
+
+/**
+ * @brief   A single timestamped reading
+ */
+typedef struct {
+    uint32_t time;      /**< seconds, any monotonic time base */
+    int16_t value;      /**< reading in tenths of the sensor unit */
+} tsbuf_sample_t;
+
+/**
+ * @brief   Ring buffer of readings
+ */
+typedef struct {
+    tsbuf_sample_t samples[TSBUF_SIZE]; /**< storage */
+    uint16_t head;                      /**< position of the oldest reading */
+    uint16_t count;                     /**< number of stored readings */
+    uint32_t dropped;                   /**< readings overwritten while full */
+} tsbuf_t;
+
+/**
+ * @brief   Initialize an empty buffer
+ */
+void tsbuf_init(tsbuf_t *b);
+
+/**
+ * @brief   Store a reading, overwriting the oldest one when full
+ */
+void tsbuf_push(tsbuf_t *b, uint32_t time, int16_t value);
+
+/**
+ * @brief   Number of readings waiting to be sent
+ */
+static inline unsigned tsbuf_count(const tsbuf_t *b)
+{
+    return b->count;
+}
+
+/**
+ * @brief   Compress the oldest readings into a block
+ *
+ * As many readings as fit into @p size bytes are encoded, the buffer itself
+ * is not modified.
+ *
+ * @param[in]  b        buffer to read from
+ * @param[out] buf      destination of the block
+ * @param[in]  size     size of @p buf
+ * @param[in]  index    compact index of the sensor
+ * @param[in]  now      current time, in the time base of the readings
+ * @param[out] encoded  number of readings stored in the block
+ *
+ * @return  length of the block
+ * @return  -ENODATA if @p b is empty
+ * @return  -ENOBUFS if not even one reading fits into @p buf
+ */
+int tsbuf_encode(const tsbuf_t *b, uint8_t *buf, size_t size, uint8_t index,
+                 uint32_t now, unsigned *encoded);
+
+/**
+ * @brief   Remove the @p n oldest readings, after they were sent
+ */
+void tsbuf_consume(tsbuf_t *b, unsigned n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TSBUF_H */
@@ -0,0 +1,189 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Transmission planner of the LoRaWAN uplinks
+ *
+ * Before every uplink the planner looks at the data rate in use, chosen by
+ * hand with `loramac set dr` or by the network with ADR, at the airtime
+ * still available under the duty cycle and at the depth of the outbox, and
+ * decides:
+ *
+ * - the largest frame allowed, so buffered readings are packed as densely
+ *   as the data rate permits,
+ * - whether the uplink is confirmed: by default only a heartbeat every
+ *   TXPLAN_HEARTBEAT_US is, the others go out unconfirmed and the receiver
+ *   estimates the loss from the gaps in the frame counter. An acknowledgment
+ *   and its retries cost airtime and scarce gateway downlinks,
+ * - when the frame can go out without the MAC refusing it.
+ *
+ * The duty cycle is tracked with a token bucket filled at the duty cycle
+ * rate, TXPLAN_DUTY_CYCLE per mille of the elapsed time, up to
+ * TXPLAN_CREDIT_MAX_US. Time on air follows the Semtech formula (AN1200.13)
+ * for the spreading factor and bandwidth of each data rate.
+ *
+ * The region follows the REGION_xxx flag of the application Makefile,
+ * EU868 and US915 are known.
+ */
+
+#ifndef TXPLAN_H
+#define TXPLAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Share of the time the device may transmit, in per mille, 0 for
+ *          no limit
+ */
+#ifndef TXPLAN_DUTY_CYCLE
+#ifdef REGION_US915
+#define TXPLAN_DUTY_CYCLE       (0U)
+#else
+#define TXPLAN_DUTY_CYCLE       (10U)
+#endif
+#endif
+
+/**
+ * @brief   Most airtime that can be saved up, one hour of duty cycle
+ */
+#ifndef TXPLAN_CREDIT_MAX_US
+#define TXPLAN_CREDIT_MAX_US    (36U * 1000000U)
+#endif
+
+/**
+ * @brief   Airtime left after a confirmed uplink, in multiples of its time on
+ *          air, below which uplinks are sent unconfirmed
+ */
+#ifndef TXPLAN_CNF_RESERVE
+#define TXPLAN_CNF_RESERVE      (4U)
+#endif
+
+/**
+ * @brief   Period of the confirmed uplinks in the heartbeat mode, counted
+ *          from the last one sent whether it was acknowledged or not
+ */
+#ifndef TXPLAN_HEARTBEAT_US
+#define TXPLAN_HEARTBEAT_US     (3600U * 1000000ULL)
+#endif
+
+/**
+ * @brief   Bytes added by the LoRaWAN MAC to the application payload
+ *
+ * MHDR (1), FHDR without options (7), FPort (1) and MIC (4).
+ */
+#define TXPLAN_MAC_OVERHEAD     (13U)
+
+/**
+ * @brief   Policy for the confirmation of the uplinks
+ */
+typedef enum {
+    TXPLAN_MODE_HEARTBEAT,      /**< confirmed once per TXPLAN_HEARTBEAT_US */
+    TXPLAN_MODE_AUTO,           /**< confirmed when the budget allows it */
+    TXPLAN_MODE_CONFIRMED,      /**< always confirmed */
+    TXPLAN_MODE_UNCONFIRMED,    /**< never confirmed */
+} txplan_mode_t;
+
+/**
+ * @brief   Planner state
+ */
+typedef struct {
+    uint64_t updated;           /**< time of the last credit update, in us */
+    uint32_t credit;            /**< airtime available, in us */
+    uint32_t spent;             /**< airtime used since init, in us */
+    uint64_t acked;             /**< time of the last acknowledgment, 0 if none */
+    uint64_t heartbeat;         /**< time of the last confirmed uplink, 0 if none */
+    uint32_t deferred;          /**< uplinks held back for the duty cycle */
+    uint32_t unacked;           /**< confirmed uplinks not acknowledged */
+    txplan_mode_t mode;         /**< confirmation policy */
+} txplan_t;
+
+/**
+ * @brief   Outcome of the planning of an uplink
+ */
+typedef struct {
+    uint8_t max_len;            /**< largest payload at the data rate */
+    bool confirmed;             /**< send the uplink confirmed */
+    uint32_t airtime;           /**< time on air of the uplink, in us */
+    uint32_t wait;              /**< time before it fits the duty cycle, in us */
+} txplan_decision_t;
+
+/**
+ * @brief   Initialize the planner, with the full credit and in the heartbeat
+ *          mode, the first uplink is a heartbeat
+ *
+ * @param[in]  p        planner
+ * @param[in]  now      current time, in us
+ */
+void txplan_init(txplan_t *p, uint64_t now);
+
+/**
+ * @brief   Largest application payload allowed at a data rate
+ *
+ * @return  the limit of the region, 0 for an unknown data rate
+ */
+uint8_t txplan_max_payload(uint8_t dr);
+
+/**
+ * @brief   Time on air of an uplink
+ *
+ * @param[in]  dr       data rate
+ * @param[in]  len      length of the application payload
+ *
+ * @return  time on air in us, 0 for an unknown data rate
+ */
+uint32_t txplan_airtime(uint8_t dr, size_t len);
+
+/**
+ * @brief   Plan an uplink
+ *
+ * @param[in]  p        planner
+ * @param[in]  now      current time, in us
+ * @param[in]  dr       data rate in use
+ * @param[in]  len      length of the payload, 0 to plan the largest frame
+ * @param[in]  backlog  frames waiting in the outbox
+ * @param[out] d        decision
+ */
+void txplan_decide(txplan_t *p, uint64_t now, uint8_t dr, size_t len,
+                   unsigned backlog, txplan_decision_t *d);
+
+/**
+ * @brief   Account for an uplink that was sent
+ *
+ * @param[in]  p        planner
+ * @param[in]  now      current time, in us
+ * @param[in]  airtime  time on air of the uplink, in us
+ */
+void txplan_spend(txplan_t *p, uint64_t now, uint32_t airtime);
+
+/**
+ * @brief   Account for the outcome of a confirmed uplink that was sent
+ *
+ * @param[in]  p        planner
+ * @param[in]  now      current time, in us
+ * @param[in]  acked    true if the network acknowledged it
+ */
+void txplan_confirmed(txplan_t *p, uint64_t now, bool acked);
+
+/**
+ * @brief   Account for an uplink held back for the duty cycle
+ */
+static inline void txplan_defer(txplan_t *p)
+{
+    p->deferred++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TXPLAN_H */
@@ -0,0 +1,82 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Data model shared by the weather station applications
+ */
+
+#ifndef WEATHER_H
+#define WEATHER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Maximum number of sensors mounted on a weather station
+ *
+ * The buffers of a station are sized for this many sensors, whatever the
+ * stations of the topology actually have.
+ */
+#ifndef WEATHER_SENSORS_NUMOF
+#define WEATHER_SENSORS_NUMOF   (5U)
+#endif
+
+/**
+ * @brief   Number of steps of a reading per unit of its sensor
+ */
+#define WEATHER_VALUE_SCALE     (10)
+
+/**
+ * @brief   Reading of a sensor, a fixed point number in tenths of the unit
+ *
+ * This is the resolution of the HTS221, so its readings are carried from the
+ * driver to the uplink without rounding and without floating point.
+ */
+typedef int16_t weather_value_t;
+
+/**
+ * @brief   Kind of measure of a sensor, selects the driver that reads it
+ */
+typedef enum {
+    WEATHER_KIND_TEMPERATURE,       /**< temperature, in C */
+    WEATHER_KIND_HUMIDITY,          /**< relative humidity, in percent */
+    WEATHER_KIND_WIND_DIRECTION,    /**< wind direction, in degrees */
+    WEATHER_KIND_WIND_INTENSITY,    /**< wind intensity, in m/s */
+    WEATHER_KIND_RAIN,              /**< rain height, in mm/h */
+    WEATHER_KIND_NUMOF              /**< number of kinds */
+} weather_kind_t;
+
+/**
+*Struct declaration that rappresent all the five sensors mounted on the board(weather station)
+*/
+typedef struct
+{
+  const char *ID;
+  weather_value_t value;        /* in tenths, see WEATHER_VALUE_SCALE */
+  const char *sensorName;
+  const char *sensorType;
+  uint8_t kind;                 /* a weather_kind_t */
+
+}sensor;
+
+/**
+*Struct declaration thta rappresents the station
+*/
+typedef struct station{
+    sensor sensors[WEATHER_SENSORS_NUMOF];
+    const char *name;
+    uint8_t numof;                /* number of sensors actually mounted */
+}weatherStation;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEATHER_H */
@@ -0,0 +1,81 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Wind vector summary of a window of readings
+ *
+ * Every pair of direction and speed readings is split into its east (u) and
+ * north (v) components, which are summed over the window. The mean direction
+ * is the direction of the summed vector, so 350 and 10 degrees average to 0
+ * and not to 180. The mean speed is the mean of the speeds and the gust the
+ * largest one, as usual for weather reports.
+ *
+ * Directions are in tenths of degree, clockwise from north, and the trigonometry
+ * runs on integers with CORDIC, so no floating point is needed.
+ */
+
+#ifndef WIND_H
+#define WIND_H
+
+#include <stdint.h>
+
+#include "weather.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Tenths of degree in a full turn
+ */
+#define WIND_TURN           (3600)
+
+/**
+ * @brief   Running wind vector summary of a window
+ */
+typedef struct {
+    uint32_t count;         /**< number of readings in the window */
+    int64_t u;              /**< sum of the east components */
+    int64_t v;              /**< sum of the north components */
+    uint64_t speed;         /**< sum of the speeds, in tenths */
+    weather_value_t gust;   /**< largest speed, in tenths */
+} wind_t;
+
+/**
+ * @brief   Start an empty window
+ */
+void wind_init(wind_t *w);
+
+/**
+ * @brief   Add a reading to the window
+ *
+ * @param[in]  w            window
+ * @param[in]  direction    direction, in tenths of degree
+ * @param[in]  speed        speed, in tenths
+ */
+void wind_add(wind_t *w, weather_value_t direction, weather_value_t speed);
+
+/**
+ * @brief   Vector mean direction of the window
+ *
+ * @return  the direction in tenths of degree, in [0, WIND_TURN), 0 for an
+ *          empty or calm window
+ */
+weather_value_t wind_direction(const wind_t *w);
+
+/**
+ * @brief   Mean speed of the window
+ *
+ * @return  the speed in tenths, 0 for an empty window
+ */
+weather_value_t wind_speed(const wind_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIND_H */
@@ -0,0 +1,91 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Sequence numbered message IDs
+ */
+
+#include <string.h>
+
+#include "mutex.h"
+
+#include "msgid.h"
+
+#ifdef MODULE_PERIPH_EEPROM
+#include "periph/eeprom.h"
+#endif
+
+static mutex_t _lock = MUTEX_INIT;
+static msgid_t _next;
+
+#ifdef MODULE_PERIPH_EEPROM
+/* record: magic, epoch and the end of the lease, in host byte order */
+static const char _magic[4] = { 'W', 'M', 'I', 'D' };
+#define RECORD_LEN      (12U)
+
+static uint32_t _lease_end;
+
+static void _store(void)
+{
+    uint8_t rec[RECORD_LEN];
+
+    memcpy(rec, _magic, sizeof(_magic));
+    memcpy(&rec[4], &_next.epoch, 4);
+    memcpy(&rec[8], &_lease_end, 4);
+    eeprom_write(MSGID_EEPROM_START, rec, sizeof(rec));
+}
+#endif
+
+void msgid_init(const char *node, uint32_t epoch)
+{
+    mutex_lock(&_lock);
+
+    _next.node = node;
+    _next.epoch = epoch;
+    _next.seq = 0;
+
+#ifdef MODULE_PERIPH_EEPROM
+    uint8_t rec[RECORD_LEN];
+
+    _next.epoch = 0;
+    if ((eeprom_read(MSGID_EEPROM_START, rec, sizeof(rec)) == sizeof(rec)) &&
+        (memcmp(rec, _magic, sizeof(_magic)) == 0)) {
+        /* resume after the lease of the previous boot */
+        memcpy(&_next.epoch, &rec[4], 4);
+        memcpy(&_next.seq, &rec[8], 4);
+        _next.epoch++;
+    }
+    _lease_end = _next.seq + MSGID_LEASE;
+    _store();
+#endif
+
+    mutex_unlock(&_lock);
+}
+
+void msgid_next(msgid_t *id)
+{
+    mutex_lock(&_lock);
+
+    *id = _next;
+    _next.seq++;
+
+#ifdef MODULE_PERIPH_EEPROM
+    if (_next.seq >= _lease_end) {
+        _lease_end += MSGID_LEASE;
+        _store();
+    }
+#endif
+
+    mutex_unlock(&_lock);
+}
+
+void msgid_peek(msgid_t *id)
+{
+    mutex_lock(&_lock);
+    *id = _next;
+    mutex_unlock(&_lock);
+}
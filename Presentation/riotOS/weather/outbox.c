@@ -0,0 +1,320 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Store-and-forward outbox of the uplink frames
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "outbox.h"
+#include "payload.h"
+
+#ifdef MODULE_PERIPH_EEPROM
+#include "periph/eeprom.h"
+#endif
+
+/* every frame is stored after its length (2) and the time it was queued (4),
+ * in host byte order */
+#define AGE_MAX             (0xffffU)
+#define BATCH_FRAME_MAXLEN  (0xffU)
+
+#ifdef MODULE_PERIPH_EEPROM
+/* header of the copy: magic, size of the ring, head, used and count */
+#define COPY_HEADER_LEN     (12U)
+
+static const char _magic[4] = { 'W', 'O', 'B', 'X' };
+#endif
+
+static void _read(const outbox_t *ob, unsigned pos, void *buf, size_t len)
+{
+    size_t first = OUTBOX_SIZE - pos;
+
+    if (first >= len) {
+        memcpy(buf, &ob->data[pos], len);
+    }
+    else {
+        memcpy(buf, &ob->data[pos], first);
+        memcpy((uint8_t *)buf + first, ob->data, len - first);
+    }
+}
+
+#ifdef MODULE_PERIPH_EEPROM
+static void _sync_header(const outbox_t *ob)
+{
+    uint8_t hdr[COPY_HEADER_LEN];
+    uint16_t size = OUTBOX_SIZE;
+
+    if (ob->eeprom == 0) {
+        return;
+    }
+    memcpy(hdr, _magic, sizeof(_magic));
+    memcpy(&hdr[4], &size, 2);
+    memcpy(&hdr[6], &ob->head, 2);
+    memcpy(&hdr[8], &ob->used, 2);
+    memcpy(&hdr[10], &ob->count, 2);
+    eeprom_write(ob->eeprom, hdr, sizeof(hdr));
+}
+
+static void _sync_data(const outbox_t *ob, unsigned pos, size_t len)
+{
+    size_t first = OUTBOX_SIZE - pos;
+    uint32_t base = ob->eeprom + COPY_HEADER_LEN;
+
+    if (ob->eeprom == 0) {
+        return;
+    }
+    if (first >= len) {
+        eeprom_write(base + pos, &ob->data[pos], len);
+    }
+    else {
+        eeprom_write(base + pos, &ob->data[pos], first);
+        eeprom_write(base, ob->data, len - first);
+    }
+}
+#else
+static void _sync_header(const outbox_t *ob)
+{
+    (void)ob;
+}
+
+static void _sync_data(const outbox_t *ob, unsigned pos, size_t len)
+{
+    (void)ob;
+    (void)pos;
+    (void)len;
+}
+#endif
+
+static void _write(outbox_t *ob, unsigned pos, const void *data, size_t len)
+{
+    size_t first = OUTBOX_SIZE - pos;
+
+    if (first >= len) {
+        memcpy(&ob->data[pos], data, len);
+    }
+    else {
+        memcpy(&ob->data[pos], data, first);
+        memcpy(ob->data, (const uint8_t *)data + first, len - first);
+    }
+}
+
+/* length and queuing time of the frame stored at pos */
+static uint16_t _header(const outbox_t *ob, unsigned pos, uint32_t *time)
+{
+    uint8_t hdr[OUTBOX_FRAME_HEADER_LEN];
+    uint16_t len;
+
+    _read(ob, pos, hdr, sizeof(hdr));
+    memcpy(&len, hdr, 2);
+    if (time) {
+        memcpy(time, &hdr[2], 4);
+    }
+    return len;
+}
+
+static unsigned _advance(unsigned pos, size_t len)
+{
+    return (pos + len) % OUTBOX_SIZE;
+}
+
+/* remove the oldest frames, without writing the copy */
+static void _drop(outbox_t *ob, unsigned n)
+{
+    while (n-- && ob->count) {
+        size_t len = OUTBOX_FRAME_HEADER_LEN + _header(ob, ob->head, NULL);
+        ob->head = _advance(ob->head, len);
+        ob->used -= len;
+        ob->count--;
+    }
+    if (ob->count == 0) {
+        ob->head = 0;
+    }
+}
+
+void outbox_init(outbox_t *ob)
+{
+    memset(ob, 0, sizeof(*ob));
+}
+
+int outbox_push(outbox_t *ob, uint32_t time, const void *data, size_t len)
+{
+    size_t need = OUTBOX_FRAME_HEADER_LEN + len;
+    uint8_t hdr[OUTBOX_FRAME_HEADER_LEN];
+    uint16_t len16 = len;
+
+    if (need > OUTBOX_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    unsigned evicted = 0;
+    while (OUTBOX_SIZE - ob->used < need) {
+        _drop(ob, 1);
+        ob->dropped++;
+        evicted++;
+    }
+
+    /* the new frame overwrites the evicted ones, the copy stops counting
+     * them before their bytes change */
+    if (evicted) {
+        _sync_header(ob);
+    }
+
+    unsigned pos = _advance(ob->head, ob->used);
+    memcpy(hdr, &len16, 2);
+    memcpy(&hdr[2], &time, 4);
+    _write(ob, pos, hdr, sizeof(hdr));
+    _write(ob, _advance(pos, sizeof(hdr)), data, len);
+
+    /* the header of the copy is written last, an interrupted write leaves
+     * the frames queued before, less the evicted ones */
+    _sync_data(ob, pos, need);
+    ob->used += need;
+    ob->count++;
+    ob->queued++;
+    _sync_header(ob);
+
+    return 0;
+}
+
+int outbox_peek(const outbox_t *ob, void *buf, size_t size)
+{
+    if (ob->count == 0) {
+        return -ENODATA;
+    }
+
+    uint16_t len = _header(ob, ob->head, NULL);
+    if (len > size) {
+        return -ENOBUFS;
+    }
+    _read(ob, _advance(ob->head, OUTBOX_FRAME_HEADER_LEN), buf, len);
+    return len;
+}
+
+int outbox_batch(const outbox_t *ob, uint8_t *buf, size_t size, uint32_t now,
+                 unsigned *packed)
+{
+    unsigned pos = ob->head;
+    size_t out = OUTBOX_BATCH_HEADER_LEN;
+    unsigned n = 0;
+
+    *packed = 0;
+    if (ob->count == 0) {
+        return -ENODATA;
+    }
+    if (size < OUTBOX_BATCH_HEADER_LEN) {
+        return -ENOBUFS;
+    }
+
+    buf[0] = PAYLOAD_FRAME_BATCH;
+    for (; n < ob->count; n++) {
+        uint32_t time;
+        uint16_t len = _header(ob, pos, &time);
+
+        if ((len > BATCH_FRAME_MAXLEN) ||
+            (out + OUTBOX_BATCH_ENTRY_LEN + len > size)) {
+            break;
+        }
+
+        uint32_t age = now - time;
+        if (age > AGE_MAX) {
+            age = AGE_MAX;
+        }
+        buf[out++] = age >> 8;
+        buf[out++] = age & 0xff;
+        buf[out++] = len;
+        _read(ob, _advance(pos, OUTBOX_FRAME_HEADER_LEN), &buf[out], len);
+        out += len;
+        pos = _advance(pos, OUTBOX_FRAME_HEADER_LEN + len);
+    }
+
+    if (n == 0) {
+        return -ENOBUFS;
+    }
+    *packed = n;
+    return out;
+}
+
+void outbox_consume(outbox_t *ob, unsigned n)
+{
+    if (n > ob->count) {
+        n = ob->count;
+    }
+    _drop(ob, n);
+    ob->replayed += n;
+    _sync_header(ob);
+}
+
+void outbox_clear(outbox_t *ob)
+{
+    _drop(ob, ob->count);
+    _sync_header(ob);
+}
+
+#ifdef MODULE_PERIPH_EEPROM
+int outbox_attach(outbox_t *ob, uint32_t pos, uint32_t now)
+{
+    uint8_t hdr[COPY_HEADER_LEN];
+    uint16_t size, head, used, count;
+
+    ob->eeprom = pos;
+
+    if (eeprom_read(pos, hdr, sizeof(hdr)) == sizeof(hdr)) {
+        memcpy(&size, &hdr[4], 2);
+        memcpy(&head, &hdr[6], 2);
+        memcpy(&used, &hdr[8], 2);
+        memcpy(&count, &hdr[10], 2);
+    }
+    else {
+        size = 0;
+    }
+
+    /* a copy made with another OUTBOX_SIZE cannot be read back */
+    if ((memcmp(hdr, _magic, sizeof(_magic)) != 0) || (size != OUTBOX_SIZE) ||
+        (head >= OUTBOX_SIZE) || (used > OUTBOX_SIZE)) {
+        if ((eeprom_write(pos + COPY_HEADER_LEN, ob->data, OUTBOX_SIZE) != OUTBOX_SIZE)) {
+            ob->eeprom = 0;
+            return -EIO;
+        }
+        _sync_header(ob);
+        return 0;
+    }
+
+    eeprom_read(pos + COPY_HEADER_LEN, ob->data, OUTBOX_SIZE);
+    ob->head = head;
+    ob->used = used;
+    ob->count = count;
+
+    /* the frames must fill exactly what the header counts, anything else is
+     * a copy damaged by a reset in the middle of a write */
+    size_t total = 0;
+    unsigned p = head;
+    for (unsigned i = 0; i < count && total <= used; i++) {
+        size_t len = OUTBOX_FRAME_HEADER_LEN + _header(ob, p, NULL);
+        total += len;
+        p = _advance(p, len);
+    }
+    if (total != used) {
+        ob->head = 0;
+        ob->used = 0;
+        ob->count = 0;
+        _sync_header(ob);
+        return -EBADMSG;
+    }
+
+    /* uptime restarted with the board, date the frames from now on */
+    p = head;
+    for (unsigned i = 0; i < count; i++) {
+        uint16_t len = _header(ob, p, NULL);
+        _write(ob, _advance(p, 2), &now, 4);
+        p = _advance(p, OUTBOX_FRAME_HEADER_LEN + len);
+    }
+
+    return count;
+}
+#endif
@@ -0,0 +1,356 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Bounded, single pass payload writer
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "payload.h"
+
+void payload_init(payload_t *p, char *buf, size_t size)
+{
+    p->buf = buf;
+    p->size = size;
+    p->len = 0;
+    p->overflow = (size == 0);
+}
+
+void payload_append_n(payload_t *p, const char *data, size_t len)
+{
+    /* always keep one byte for the terminating '\0' */
+    size_t room = (p->size > p->len) ? (p->size - p->len - 1) : 0;
+
+    if (len > room) {
+        len = room;
+        p->overflow = true;
+    }
+    memcpy(&p->buf[p->len], data, len);
+    p->len += len;
+}
+
+void payload_append(payload_t *p, const char *str)
+{
+    payload_append_n(p, str, strlen(str));
+}
+
+void payload_append_char(payload_t *p, char c)
+{
+    payload_append_n(p, &c, 1);
+}
+
+void payload_append_fixed(payload_t *p, int32_t value, unsigned decimals)
+{
+    /* sign, up to 10 digits and the decimal point, filled from the end */
+    char tmp[12];
+    unsigned pos = sizeof(tmp);
+    unsigned digits = 0;
+    uint32_t mag = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+
+    do {
+        if (decimals && (digits == decimals)) {
+            tmp[--pos] = '.';
+        }
+        tmp[--pos] = '0' + (mag % 10);
+        mag /= 10;
+        digits++;
+    } while (mag || (digits <= decimals));
+
+    if (value < 0) {
+        tmp[--pos] = '-';
+    }
+    payload_append_n(p, &tmp[pos], sizeof(tmp) - pos);
+}
+
+static void _append_uint(payload_t *p, uint32_t value)
+{
+    char tmp[10];
+    unsigned pos = sizeof(tmp);
+
+    do {
+        tmp[--pos] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+    payload_append_n(p, &tmp[pos], sizeof(tmp) - pos);
+}
+
+void payload_append_msgid(payload_t *p, const msgid_t *id)
+{
+    if (id->node) {
+        payload_append(p, id->node);
+    }
+    payload_append_char(p, ':');
+    _append_uint(p, id->epoch);
+    payload_append_char(p, ':');
+    _append_uint(p, id->seq);
+}
+
+int payload_finish(payload_t *p)
+{
+    if (p->size) {
+        p->buf[p->len] = '\0';
+    }
+    return p->overflow ? -ENOBUFS : (int)p->len;
+}
+
+static void _append_value(payload_t *p, weather_value_t value)
+{
+    payload_append_fixed(p, value, 1);
+}
+
+/* document of a sensor up to its value, included */
+static void _append_sensor(payload_t *p, const sensor *s, weather_value_t value)
+{
+    payload_append(p, "{\"sensorName\":\"");
+    payload_append(p, s->sensorName);
+    payload_append(p, "\",\n\"sensorType\":\"");
+    payload_append(p, s->sensorType);
+    payload_append(p, "\",\n\"origin\":\"physical Device\",\n\"sensorID\":\"");
+    payload_append(p, s->ID);
+    payload_append(p, "\",\n\"value\":");
+    _append_value(p, value);
+}
+
+int payload_sensor_json(char *buf, size_t size, const sensor *s,
+                        const msgid_t *id)
+{
+    payload_t p;
+
+    payload_init(&p, buf, size);
+
+    _append_sensor(&p, s, s->value);
+    payload_append(&p, ",\n\"ID\":\"");
+    payload_append_msgid(&p, id);
+    payload_append(&p, "\"}");
+
+    return payload_finish(&p);
+}
+
+int payload_summary_json(char *buf, size_t size, const sensor *s,
+                         const aggr_t *a, const msgid_t *id)
+{
+    payload_t p;
+
+    payload_init(&p, buf, size);
+
+    _append_sensor(&p, s, aggr_mean(a));
+    payload_append(&p, ",\n\"min\":");
+    _append_value(&p, a->count ? a->min : 0);
+    payload_append(&p, ",\"max\":");
+    _append_value(&p, a->count ? a->max : 0);
+    payload_append(&p, ",\"stddev\":");
+    _append_value(&p, aggr_stddev(a));
+    payload_append(&p, ",\"count\":");
+    _append_uint(&p, a->count);
+    payload_append(&p, ",\n\"ID\":\"");
+    payload_append_msgid(&p, id);
+    payload_append(&p, "\"}");
+
+    return payload_finish(&p);
+}
+
+int payload_rain_json(char *buf, size_t size, const sensor *s,
+                      const rain_report_t *r, const msgid_t *id)
+{
+    payload_t p;
+
+    payload_init(&p, buf, size);
+
+    _append_sensor(&p, s, r->intensity);
+    payload_append(&p, ",\n\"total\":");
+    _append_value(&p, r->total);
+    payload_append(&p, ",\"peak\":");
+    _append_value(&p, r->peak);
+    payload_append(&p, ",\"tips\":");
+    _append_uint(&p, r->tips);
+    payload_append(&p, ",\"span\":");
+    _append_uint(&p, r->span);
+    payload_append(&p, ",\n\"ID\":\"");
+    payload_append_msgid(&p, id);
+    payload_append(&p, "\"}");
+
+    return payload_finish(&p);
+}
+
+int payload_wind_json(char *buf, size_t size, const char *station,
+                      const sensor *dir, const sensor *speed, const wind_t *w,
+                      const msgid_t *id)
+{
+    payload_t p;
+
+    payload_init(&p, buf, size);
+
+    payload_append(&p, "{\"station\":\"");
+    payload_append(&p, station);
+    payload_append(&p, "\",\n\"origin\":\"physical Device\",\n\"readings\":[\n{\"sensorID\":\"");
+    payload_append(&p, dir->ID);
+    payload_append(&p, "\",\"value\":");
+    _append_value(&p, wind_direction(w));
+    payload_append(&p, "},\n{\"sensorID\":\"");
+    payload_append(&p, speed->ID);
+    payload_append(&p, "\",\"value\":");
+    _append_value(&p, wind_speed(w));
+    payload_append(&p, ",\"gust\":");
+    _append_value(&p, w->gust);
+    payload_append(&p, "}],\n\"count\":");
+    _append_uint(&p, w->count);
+    payload_append(&p, ",\n\"ID\":\"");
+    payload_append_msgid(&p, id);
+    payload_append(&p, "\"}");
+
+    return payload_finish(&p);
+}
+
+int payload_station_json(char *buf, size_t size, const weatherStation *st,
+                         const msgid_t *id)
+{
+    payload_t p;
+
+    payload_init(&p, buf, size);
+
+    payload_append(&p, "{\"station\":\"");
+    payload_append(&p, st->name);
+    payload_append(&p, "\",\n\"origin\":\"physical Device\",\n\"readings\":[");
+    for (unsigned i = 0; i < st->numof; i++) {
+        payload_append(&p, (i == 0) ? "\n{\"sensorID\":\"" : ",\n{\"sensorID\":\"");
+        payload_append(&p, st->sensors[i].ID);
+        payload_append(&p, "\",\"value\":");
+        _append_value(&p, st->sensors[i].value);
+        payload_append_char(&p, '}');
+    }
+    payload_append(&p, "],\n\"ID\":\"");
+    payload_append_msgid(&p, id);
+    payload_append(&p, "\"}");
+
+    return payload_finish(&p);
+}
+
+int payload_reading_frame(uint8_t *buf, size_t size, uint8_t index,
+                          weather_value_t value, uint16_t seq)
+{
+    if (size < PAYLOAD_FRAME_READING_LEN) {
+        return -ENOBUFS;
+    }
+
+    buf[0] = PAYLOAD_FRAME_READING;
+    buf[1] = seq >> 8;
+    buf[2] = seq & 0xff;
+    buf[3] = index;
+    buf[4] = (uint16_t)value >> 8;
+    buf[5] = (uint16_t)value & 0xff;
+
+    return PAYLOAD_FRAME_READING_LEN;
+}
+
+int payload_station_frame(uint8_t *buf, size_t size, uint8_t first,
+                          const weather_value_t *values, unsigned numof,
+                          uint16_t seq)
+{
+    size_t len = 4 + 2 * numof;
+
+    if (size < len) {
+        return -ENOBUFS;
+    }
+
+    buf[0] = PAYLOAD_FRAME_STATION;
+    buf[1] = seq >> 8;
+    buf[2] = seq & 0xff;
+    buf[3] = first;
+    for (unsigned i = 0; i < numof; i++) {
+        buf[4 + 2 * i] = (uint16_t)values[i] >> 8;
+        buf[5 + 2 * i] = (uint16_t)values[i] & 0xff;
+    }
+
+    return len;
+}
+
+int payload_summary_frame(uint8_t *buf, size_t size, uint8_t index,
+                          const aggr_t *a, uint16_t seq)
+{
+    uint16_t count = (a->count > UINT16_MAX) ? UINT16_MAX : a->count;
+    weather_value_t fields[] = {
+        a->count ? a->min : 0,
+        a->count ? a->max : 0,
+        aggr_mean(a),
+        aggr_stddev(a),
+    };
+
+    if (size < PAYLOAD_FRAME_SUMMARY_LEN) {
+        return -ENOBUFS;
+    }
+
+    buf[0] = PAYLOAD_FRAME_SUMMARY;
+    buf[1] = seq >> 8;
+    buf[2] = seq & 0xff;
+    buf[3] = index;
+    buf[4] = count >> 8;
+    buf[5] = count & 0xff;
+    for (unsigned i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        buf[6 + 2 * i] = (uint16_t)fields[i] >> 8;
+        buf[7 + 2 * i] = (uint16_t)fields[i] & 0xff;
+    }
+
+    return PAYLOAD_FRAME_SUMMARY_LEN;
+}
+
+int payload_wind_frame(uint8_t *buf, size_t size, uint8_t dir, uint8_t speed,
+                       const wind_t *w, uint16_t seq)
+{
+    uint16_t count = (w->count > UINT16_MAX) ? UINT16_MAX : w->count;
+    weather_value_t fields[] = {
+        wind_direction(w),
+        wind_speed(w),
+        w->gust,
+    };
+
+    if (size < PAYLOAD_FRAME_WIND_LEN) {
+        return -ENOBUFS;
+    }
+
+    buf[0] = PAYLOAD_FRAME_WIND;
+    buf[1] = seq >> 8;
+    buf[2] = seq & 0xff;
+    buf[3] = dir;
+    buf[4] = speed;
+    buf[5] = count >> 8;
+    buf[6] = count & 0xff;
+    for (unsigned i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        buf[7 + 2 * i] = (uint16_t)fields[i] >> 8;
+        buf[8 + 2 * i] = (uint16_t)fields[i] & 0xff;
+    }
+
+    return PAYLOAD_FRAME_WIND_LEN;
+}
+
+int payload_rain_frame(uint8_t *buf, size_t size, uint8_t index,
+                       const rain_report_t *r, uint16_t seq)
+{
+    uint16_t fields[] = {
+        (r->tips > UINT16_MAX) ? UINT16_MAX : r->tips,
+        (r->span > UINT16_MAX) ? UINT16_MAX : r->span,
+        r->total,
+        r->intensity,
+        r->peak,
+    };
+
+    if (size < PAYLOAD_FRAME_RAIN_LEN) {
+        return -ENOBUFS;
+    }
+
+    buf[0] = PAYLOAD_FRAME_RAIN;
+    buf[1] = seq >> 8;
+    buf[2] = seq & 0xff;
+    buf[3] = index;
+    for (unsigned i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        buf[4 + 2 * i] = fields[i] >> 8;
+        buf[5 + 2 * i] = fields[i] & 0xff;
+    }
+
+    return PAYLOAD_FRAME_RAIN_LEN;
+}
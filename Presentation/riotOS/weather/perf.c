@@ -0,0 +1,112 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Time spent in the stages of the telemetry pipeline
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+#include "xtimer.h"
+
+#ifdef MODULE_CORTEXM_COMMON
+#include "cpu.h"
+#endif
+
+#include "perf.h"
+
+/* the ARMv6-M cores have no cycle counter, their CMSIS headers lack it */
+#if defined(MODULE_CORTEXM_COMMON) && defined(DWT_CTRL_CYCCNTENA_Msk)
+#define HAS_CYCCNT          (1)
+#endif
+
+void perf_init(void)
+{
+#ifdef HAS_CYCCNT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+uint32_t perf_now(void)
+{
+#ifdef HAS_CYCCNT
+    return DWT->CYCCNT;
+#else
+    return xtimer_now_usec();
+#endif
+}
+
+const char *perf_unit(void)
+{
+#ifdef HAS_CYCCNT
+    return "cycles";
+#else
+    return "us";
+#endif
+}
+
+void perf_stop(perf_stage_t *s, uint32_t start)
+{
+    uint32_t d = perf_now() - start;
+    unsigned bits = d ? 32 - __builtin_clz(d) : 0;
+
+    unsigned irq = irq_disable();
+    s->count++;
+    s->sum += d;
+    if (d < s->min) {
+        s->min = d;
+    }
+    if (d > s->max) {
+        s->max = d;
+    }
+    s->buckets[bits]++;
+    irq_restore(irq);
+}
+
+void perf_reset(perf_stage_t *s)
+{
+    unsigned irq = irq_disable();
+    s->count = 0;
+    s->sum = 0;
+    s->min = UINT32_MAX;
+    s->max = 0;
+    memset(s->buckets, 0, sizeof(s->buckets));
+    irq_restore(irq);
+}
+
+void perf_print(const perf_stage_t *s)
+{
+    perf_stage_t copy;
+
+    unsigned irq = irq_disable();
+    copy = *s;
+    irq_restore(irq);
+
+    printf("%-8s n=%" PRIu32 " min=%" PRIu32 " mean=%" PRIu32 " max=%" PRIu32
+           " %s\n", copy.name, copy.count, copy.count ? copy.min : 0,
+           copy.count ? (uint32_t)(copy.sum / copy.count) : 0, copy.max,
+           perf_unit());
+
+    if (copy.count == 0) {
+        return;
+    }
+
+    /* upper bound of every bucket in use with its count */
+    printf("        ");
+    for (unsigned i = 0; i < PERF_BUCKETS; i++) {
+        if (copy.buckets[i]) {
+            uint32_t upper = (i == 32) ? UINT32_MAX : (uint32_t)((1ULL << i) - 1);
+            printf(" <=%" PRIu32 ":%" PRIu32, upper, copy.buckets[i]);
+        }
+    }
+    puts("");
+}
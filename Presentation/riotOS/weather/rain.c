@@ -0,0 +1,111 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Tipping bucket rain gauge
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+#include "irq.h"
+#include "xtimer.h"
+
+#include "rain.h"
+
+/* shared with the interrupt handler, read and reset with interrupts off */
+static uint32_t _tips;
+static uint64_t _min_gap;       /* closest tips of the collection, 0 if none */
+static uint64_t _last_tip;      /* time of the latest tip, 0 before the first */
+static uint64_t _since;         /* start of the collection */
+static bool _active;
+
+#ifdef MODULE_PERIPH_GPIO_IRQ
+static void _tip(void *arg)
+{
+    (void)arg;
+    uint64_t now = xtimer_now_usec64();
+
+    if (_last_tip) {
+        uint64_t gap = now - _last_tip;
+
+        if (gap < RAIN_DEBOUNCE_US) {
+            return;
+        }
+        if (!_min_gap || gap < _min_gap) {
+            _min_gap = gap;
+        }
+    }
+    _last_tip = now;
+    _tips++;
+}
+#endif
+
+/* intensity of tips over us microseconds, in tenths of mm/h */
+static weather_value_t _intensity(uint32_t tips, uint64_t us)
+{
+    uint64_t tenths = (uint64_t)tips * RAIN_TIP_UM * 36000000ULL / us;
+
+    return (tenths > INT16_MAX) ? INT16_MAX : (weather_value_t)tenths;
+}
+
+static void _report(rain_report_t *r, bool restart)
+{
+    uint64_t now = xtimer_now_usec64();
+
+    unsigned irq = irq_disable();
+    uint32_t tips = _tips;
+    uint64_t min_gap = _min_gap;
+    uint64_t span = now - _since;
+    if (restart) {
+        _tips = 0;
+        _min_gap = 0;
+        _since = now;
+    }
+    irq_restore(irq);
+
+    uint64_t total = (uint64_t)tips * RAIN_TIP_UM / 100U;
+
+    r->tips = tips;
+    r->span = span / US_PER_SEC;
+    r->total = (total > INT16_MAX) ? INT16_MAX : (weather_value_t)total;
+    r->intensity = span ? _intensity(tips, span) : 0;
+    r->peak = min_gap ? _intensity(1, min_gap) : 0;
+    if (r->peak < r->intensity) {
+        r->peak = r->intensity;
+    }
+}
+
+int rain_init(gpio_t pin)
+{
+#ifdef MODULE_PERIPH_GPIO_IRQ
+    _since = xtimer_now_usec64();
+    if (gpio_init_int(pin, GPIO_IN_PU, GPIO_FALLING, _tip, NULL) < 0) {
+        return -EIO;
+    }
+    _active = true;
+    return 0;
+#else
+    (void)pin;
+    return -ENOTSUP;
+#endif
+}
+
+bool rain_is_active(void)
+{
+    return _active;
+}
+
+void rain_take(rain_report_t *r)
+{
+    _report(r, true);
+}
+
+void rain_peek(rain_report_t *r)
+{
+    _report(r, false);
+}
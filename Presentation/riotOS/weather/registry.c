@@ -0,0 +1,188 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Constant registry of the stations and sensors
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "registry.h"
+
+#ifdef MODULE_PERIPH_EEPROM
+#include "periph/eeprom.h"
+#endif
+
+/* _sensor_names, _sensor_uuids and _station_names, linear probing hash
+ * indexes generated from the topology by weather/dist/topology.py. Buckets
+ * hold the position of the entry + 1, 0 marks an empty bucket, the number of
+ * buckets is a power of two at least twice the number of entries */
+#include "registry_index.h"
+
+#define _BUCKETS(index)     (sizeof(index) / sizeof(index[0]))
+
+/* FNV-1a */
+static uint32_t _hash(const char *str)
+{
+    uint32_t h = 2166136261U;
+
+    while (*str) {
+        h ^= (uint8_t)*str++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/* key_of returns the key of the entry at a position */
+static int _lookup(const uint16_t *index, unsigned buckets, const char *key,
+                   const char *(*key_of)(unsigned))
+{
+    uint32_t b = _hash(key);
+    uint16_t entry;
+
+    while ((entry = index[b & (buckets - 1)])) {
+        if (strcmp(key_of(entry - 1), key) == 0) {
+            return entry - 1;
+        }
+        b++;
+    }
+    return -1;
+}
+
+static const char *_sensor_name(unsigned pos)
+{
+    return registry_sensors[pos].sensorName;
+}
+
+static const char *_sensor_uuid(unsigned pos)
+{
+    return registry_sensors[pos].ID;
+}
+
+static const char *_station_name(unsigned pos)
+{
+    return registry_stations[pos].name;
+}
+
+int registry_init(void)
+{
+    /* the binary frames carry the compact IDs in one byte */
+    if (registry_sensors_numof > UINT8_MAX + 1) {
+        return -EOVERFLOW;
+    }
+
+    for (unsigned i = 0; i < registry_sensors_numof; i++) {
+        const registry_station_t *st = &registry_stations[registry_sensors[i].station];
+        if ((i < st->first) || (i >= st->first + st->numof)) {
+            return -EINVAL;
+        }
+    }
+
+    /* an index generated from another topology finds the wrong entries */
+    for (unsigned i = 0; i < registry_sensors_numof; i++) {
+        if ((registry_sensor_by_name(registry_sensors[i].sensorName) != (int)i) ||
+            (registry_sensor_by_uuid(registry_sensors[i].ID) != (int)i)) {
+            return -EINVAL;
+        }
+    }
+    for (unsigned i = 0; i < registry_stations_numof; i++) {
+        if (registry_station_by_name(registry_stations[i].name) != (int)i) {
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+const registry_sensor_t *registry_sensor(unsigned id)
+{
+    return (id < registry_sensors_numof) ? &registry_sensors[id] : NULL;
+}
+
+const registry_station_t *registry_station(unsigned idx)
+{
+    return (idx < registry_stations_numof) ? &registry_stations[idx] : NULL;
+}
+
+int registry_sensor_by_name(const char *name)
+{
+    return _lookup(_sensor_names, _BUCKETS(_sensor_names), name, _sensor_name);
+}
+
+int registry_sensor_by_uuid(const char *uuid)
+{
+    return _lookup(_sensor_uuids, _BUCKETS(_sensor_uuids), uuid, _sensor_uuid);
+}
+
+int registry_sensor_find(const char *key)
+{
+    int id = registry_sensor_by_name(key);
+
+    if (id < 0) {
+        id = registry_sensor_by_uuid(key);
+    }
+    if (id < 0 && *key) {
+        char *end;
+        unsigned long num = strtoul(key, &end, 10);
+        if (*end == '\0' && num < registry_sensors_numof) {
+            id = num;
+        }
+    }
+    return id;
+}
+
+int registry_station_by_name(const char *name)
+{
+    return _lookup(_station_names, _BUCKETS(_station_names), name, _station_name);
+}
+
+#ifdef MODULE_PERIPH_EEPROM
+static const char _magic[4] = { 'W', 'S', 'T', 'N' };
+
+int registry_station_load(void)
+{
+    char buf[sizeof(_magic) + REGISTRY_NAME_MAXLEN];
+
+    if ((eeprom_read(REGISTRY_EEPROM_START, buf, sizeof(buf)) != sizeof(buf)) ||
+        (memcmp(buf, _magic, sizeof(_magic)) != 0)) {
+        return -ENOENT;
+    }
+
+    /* the name stored is terminated unless the EEPROM is corrupted */
+    buf[sizeof(buf) - 1] = '\0';
+
+    int idx = registry_station_by_name(buf + sizeof(_magic));
+    return (idx < 0) ? -ENOENT : idx;
+}
+
+int registry_station_save(unsigned idx)
+{
+    char buf[sizeof(_magic) + REGISTRY_NAME_MAXLEN] = { 0 };
+    const registry_station_t *st = registry_station(idx);
+
+    if ((st == NULL) || (strlen(st->name) >= REGISTRY_NAME_MAXLEN)) {
+        return -EINVAL;
+    }
+
+    memcpy(buf, _magic, sizeof(_magic));
+    strcpy(buf + sizeof(_magic), st->name);
+
+    if (eeprom_write(REGISTRY_EEPROM_START, buf, sizeof(buf)) != sizeof(buf)) {
+        return -EIO;
+    }
+    return 0;
+}
+
+void registry_station_erase(void)
+{
+    static const char blank[sizeof(_magic)] = { 0 };
+
+    eeprom_write(REGISTRY_EEPROM_START, blank, sizeof(blank));
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Lock-free queue of timestamped sensor samples
+ */
+
+#include "sampleq.h"
+
+/* the indexes run freely and wrap at UINT_MAX, a multiple of SAMPLEQ_SIZE */
+#define SLOT(i)             ((i) & (SAMPLEQ_SIZE - 1))
+
+void sampleq_init(sampleq_t *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->dropped, 0);
+}
+
+bool sampleq_push(sampleq_t *q, const sampleq_entry_t *e)
+{
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+    if (head - tail >= SAMPLEQ_SIZE) {
+        atomic_store_explicit(&q->dropped,
+                              atomic_load_explicit(&q->dropped, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+        return false;
+    }
+
+    q->buf[SLOT(head)] = *e;
+    /* publish the sample before the index that makes it visible */
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool sampleq_pop(sampleq_t *q, sampleq_entry_t *e)
+{
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *e = q->buf[SLOT(tail)];
+    /* the slot is free again only once it was copied */
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+unsigned sampleq_count(sampleq_t *q)
+{
+    return atomic_load_explicit(&q->head, memory_order_acquire) -
+           atomic_load_explicit(&q->tail, memory_order_relaxed);
+}
+
+unsigned sampleq_dropped(sampleq_t *q)
+{
+    return atomic_load_explicit(&q->dropped, memory_order_relaxed);
+}
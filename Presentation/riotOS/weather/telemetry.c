@@ -0,0 +1,260 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Telemetry scheduler thread
+ */
+
+#include <stddef.h>
+
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "telemetry.h"
+
+#define MSG_TYPE_START      (0x7e00)
+#define MSG_TYPE_STOP       (0x7e01)
+#define MSG_TYPE_RETUNE     (0x7e02)
+#define MSG_TYPE_RETRY      (0x7e03)
+
+/* longest single sleep, the timeout of xtimer_msg_receive_timeout is 32 bit */
+#define MAX_SLEEP_US        (UINT32_MAX / 2)
+
+static msg_t _queue[4];
+static mutex_t _lock = MUTEX_INIT;
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static telemetry_slot_t *_slots;
+static unsigned _numof;
+static const telemetry_cb_t *_cb;
+static bool _running;
+static uint64_t _retry_at;      /* deadline of cb->retry, 0 if none */
+
+static void _restart_slot(telemetry_slot_t *s, uint64_t now)
+{
+    s->next_sample = now + (uint64_t)s->sample_period * US_PER_SEC;
+    s->next_uplink = now + (uint64_t)s->uplink_period * US_PER_SEC;
+}
+
+/* move a deadline past now by whole periods */
+static void _advance(uint64_t *deadline, uint32_t period, uint64_t now)
+{
+    uint64_t period_us = (uint64_t)period * US_PER_SEC;
+
+    *deadline += period_us;
+    if (*deadline <= now) {
+        *deadline += ((now - *deadline) / period_us + 1) * period_us;
+    }
+}
+
+static void _handle(const msg_t *m)
+{
+    uint64_t now = xtimer_now_usec64();
+
+    mutex_lock(&_lock);
+    switch (m->type) {
+        case MSG_TYPE_START:
+            _running = true;
+            for (unsigned i = 0; i < _numof; i++) {
+                _restart_slot(&_slots[i], now);
+            }
+            break;
+        case MSG_TYPE_STOP:
+            _running = false;
+            break;
+        case MSG_TYPE_RETUNE:
+            if (m->content.value < _numof) {
+                _restart_slot(&_slots[m->content.value], now);
+            }
+            break;
+        case MSG_TYPE_RETRY:
+            /* only wakes the thread up to sleep until the new deadline */
+            break;
+        default:
+            break;
+    }
+    mutex_unlock(&_lock);
+}
+
+/* earliest enabled deadline, 0 if there is nothing to do */
+static uint64_t _next_deadline(void)
+{
+    uint64_t next;
+
+    mutex_lock(&_lock);
+    next = _retry_at;
+    for (unsigned i = 0; _running && i < _numof; i++) {
+        const telemetry_slot_t *s = &_slots[i];
+        if (s->sample_period && (!next || s->next_sample < next)) {
+            next = s->next_sample;
+        }
+        if (s->uplink_period && (!next || s->next_uplink < next)) {
+            next = s->next_uplink;
+        }
+    }
+    mutex_unlock(&_lock);
+
+    return next;
+}
+
+static void _run_due(void)
+{
+    bool retry = false;
+
+    mutex_lock(&_lock);
+    if (_retry_at && _retry_at <= xtimer_now_usec64()) {
+        _retry_at = 0;
+        retry = true;
+    }
+    mutex_unlock(&_lock);
+
+    if (retry) {
+        _cb->retry();
+    }
+
+    for (unsigned i = 0; _running && i < _numof; i++) {
+        telemetry_slot_t *s = &_slots[i];
+        uint64_t now = xtimer_now_usec64();
+        bool sample = false;
+        bool uplink = false;
+
+        mutex_lock(&_lock);
+        if (s->sample_period && s->next_sample <= now) {
+            _advance(&s->next_sample, s->sample_period, now);
+            sample = true;
+        }
+        if (s->uplink_period && s->next_uplink <= now) {
+            _advance(&s->next_uplink, s->uplink_period, now);
+            uplink = true;
+        }
+        mutex_unlock(&_lock);
+
+        /* callbacks run unlocked, they may take long (e.g. a LoRa TX) */
+        if (sample) {
+            _cb->sample(i);
+        }
+        if (uplink) {
+            _cb->uplink(i);
+        }
+    }
+}
+
+static void *_thread(void *arg)
+{
+    (void)arg;
+    msg_t m;
+
+    msg_init_queue(_queue, sizeof(_queue) / sizeof(msg_t));
+
+    while (1) {
+        uint64_t next = _next_deadline();
+
+        if (next == 0) {
+            /* nothing to do: wait for a command */
+            msg_receive(&m);
+            _handle(&m);
+            continue;
+        }
+
+        uint64_t now = xtimer_now_usec64();
+        if (next > now) {
+            uint64_t sleep = next - now;
+            if (xtimer_msg_receive_timeout(&m, (sleep > MAX_SLEEP_US) ?
+                                           MAX_SLEEP_US : (uint32_t)sleep) >= 0) {
+                _handle(&m);
+                continue;
+            }
+            if (sleep > MAX_SLEEP_US) {
+                continue;
+            }
+        }
+
+        _run_due();
+    }
+
+    return NULL;    /* should never be reached */
+}
+
+static void _send(uint16_t type, uint32_t value)
+{
+    msg_t m = { .type = type, .content.value = value };
+
+    msg_send(&m, _pid);
+}
+
+kernel_pid_t telemetry_init(char *stack, int stacksize, uint8_t prio,
+                            telemetry_slot_t *slots, unsigned numof,
+                            const telemetry_cb_t *cb)
+{
+    _slots = slots;
+    _numof = numof;
+    _cb = cb;
+    _pid = thread_create(stack, stacksize, prio, THREAD_CREATE_STACKTEST,
+                         _thread, NULL, "telemetry");
+    return _pid;
+}
+
+void telemetry_start(void)
+{
+    _send(MSG_TYPE_START, 0);
+}
+
+void telemetry_stop(void)
+{
+    _send(MSG_TYPE_STOP, 0);
+}
+
+bool telemetry_is_running(void)
+{
+    return _running;
+}
+
+void telemetry_set_periods(unsigned slot, uint32_t sample_s, uint32_t uplink_s)
+{
+    if (slot >= _numof) {
+        return;
+    }
+
+    mutex_lock(&_lock);
+    _slots[slot].sample_period = sample_s;
+    _slots[slot].uplink_period = uplink_s;
+    mutex_unlock(&_lock);
+
+    _send(MSG_TYPE_RETUNE, slot);
+}
+
+void telemetry_retry(uint32_t delay_us)
+{
+    uint64_t at = xtimer_now_usec64() + delay_us;
+
+    if (_pid == KERNEL_PID_UNDEF || _cb->retry == NULL) {
+        return;
+    }
+
+    mutex_lock(&_lock);
+    if (!_retry_at || at < _retry_at) {
+        _retry_at = at;
+    }
+    mutex_unlock(&_lock);
+
+    /* from the thread itself the deadline is picked up after the callback,
+     * the caller may hold locks the thread waits for: never block, a full
+     * queue wakes the thread up anyway */
+    if (thread_getpid() != _pid) {
+        msg_t m = { .type = MSG_TYPE_RETRY };
+        msg_try_send(&m, _pid);
+    }
+}
+
+void telemetry_get_periods(unsigned slot, uint32_t *sample_s, uint32_t *uplink_s)
+{
+    mutex_lock(&_lock);
+    *sample_s = _slots[slot].sample_period;
+    *uplink_s = _slots[slot].uplink_period;
+    mutex_unlock(&_lock);
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Registry tables compiled from the topology file
+ *
+ * The topology file of the application, WEATHER_TOPOLOGY, lists every
+ * station followed by its sensors:
+ *
+ *     WEATHER_STATION(name, number of sensors)
+ *     WEATHER_SENSOR(station name, "uuid", "sensor name", "type", kind)
+ *
+ * where kind is the suffix of a weather_kind_t, e.g. TEMPERATURE. The file
+ * is expanded here several times, so the tables, the compact IDs and the
+ * checks all come from a single description.
+ */
+
+#include "weather.h"
+#include "registry.h"
+
+#ifndef WEATHER_TOPOLOGY
+#define WEATHER_TOPOLOGY "topology.def"
+#endif
+
+/* index of every station */
+enum {
+#define WEATHER_STATION(name, numof)    _STATION_##name,
+#define WEATHER_SENSOR(station, uuid, name, type, kind)
+#include WEATHER_TOPOLOGY
+#undef WEATHER_STATION
+#undef WEATHER_SENSOR
+    _STATIONS_NUMOF
+};
+
+/* compact IDs of the first and the last sensor of every station */
+enum {
+#define WEATHER_STATION(name, numof) \
+    _FIRST_##name, _LAST_##name = _FIRST_##name + (numof) - 1,
+#define WEATHER_SENSOR(station, uuid, name, type, kind)
+#include WEATHER_TOPOLOGY
+#undef WEATHER_STATION
+#undef WEATHER_SENSOR
+    _SENSORS_NUMOF
+};
+
+#define WEATHER_STATION(name, numof) \
+    _Static_assert((numof) > 0 && (numof) <= WEATHER_SENSORS_NUMOF, \
+                   "station " #name " must have 1 to WEATHER_SENSORS_NUMOF sensors");
+#define WEATHER_SENSOR(station, uuid, name, type, kind)
+#include WEATHER_TOPOLOGY
+#undef WEATHER_STATION
+#undef WEATHER_SENSOR
+
+_Static_assert(_SENSORS_NUMOF <= UINT8_MAX + 1,
+               "the binary frames carry the compact IDs in one byte, 256 sensors at most");
+
+const registry_station_t registry_stations[] = {
+#define WEATHER_STATION(name, numof)    { #name, _FIRST_##name, (numof) },
+#define WEATHER_SENSOR(station, uuid, name, type, kind)
+#include WEATHER_TOPOLOGY
+#undef WEATHER_STATION
+#undef WEATHER_SENSOR
+};
+
+const registry_sensor_t registry_sensors[] = {
+#define WEATHER_STATION(name, numof)
+#define WEATHER_SENSOR(station, uuid, name, type, kind) \
+    { uuid, name, type, _STATION_##station, WEATHER_KIND_##kind },
+#include WEATHER_TOPOLOGY
+#undef WEATHER_STATION
+#undef WEATHER_SENSOR
+};
+
+_Static_assert(sizeof(registry_sensors) / sizeof(registry_sensors[0]) == _SENSORS_NUMOF,
+               "the sensors listed do not match the sensor counts of the stations");
+
+const unsigned registry_stations_numof = _STATIONS_NUMOF;
+const unsigned registry_sensors_numof = _SENSORS_NUMOF;
@@ -0,0 +1,64 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Binary trace of the telemetry events
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "irq.h"
+#include "xtimer.h"
+
+#include "trace.h"
+
+static trace_entry_t _ring[TRACE_SIZE];
+static uint32_t _total;             /* events recorded, the next goes to
+                                       _total % TRACE_SIZE */
+
+void trace_add(const char *event, int32_t arg)
+{
+    uint32_t now = xtimer_now_usec();
+
+    unsigned irq = irq_disable();
+    trace_entry_t *e = &_ring[_total % TRACE_SIZE];
+    e->time = now;
+    e->event = event;
+    e->arg = arg;
+    _total++;
+    irq_restore(irq);
+}
+
+void trace_print(void)
+{
+    unsigned irq = irq_disable();
+    uint32_t total = _total;
+    irq_restore(irq);
+
+    uint32_t first = (total > TRACE_SIZE) ? total - TRACE_SIZE : 0;
+    uint32_t prev = 0;
+
+    printf("%" PRIu32 " events, the last %" PRIu32 " kept\n", total, total - first);
+    for (uint32_t i = first; i < total; i++) {
+        /* an event recorded meanwhile may overwrite the oldest ones */
+        irq = irq_disable();
+        trace_entry_t e = _ring[i % TRACE_SIZE];
+        irq_restore(irq);
+
+        printf("%10" PRIu32 " us %+10" PRId32 " us  %-16s %" PRId32 "\n",
+               e.time, (i == first) ? 0 : (int32_t)(e.time - prev), e.event, e.arg);
+        prev = e.time;
+    }
+}
+
+void trace_clear(void)
+{
+    unsigned irq = irq_disable();
+    _total = 0;
+    irq_restore(irq);
+}
@@ -0,0 +1,192 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Time series ring buffer with compressed flushing
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "payload.h"
+#include "tsbuf.h"
+
+/* upper bound of the count field of a block */
+#define BLOCK_MAX_COUNT     (255U)
+
+typedef struct {
+    uint8_t *buf;
+    size_t bits;        /* capacity in bits */
+    size_t pos;         /* next bit to write */
+} _bitwriter_t;
+
+static void _put_bits(_bitwriter_t *w, uint32_t val, unsigned n)
+{
+    while (n--) {
+        uint8_t mask = 0x80 >> (w->pos & 7);
+        if (val & (1UL << n)) {
+            w->buf[w->pos >> 3] |= mask;
+        }
+        w->pos++;
+    }
+}
+
+/* number of bits needed by a delta-of-delta and by a value delta */
+static unsigned _dod_bits(int32_t d)
+{
+    if (d == 0) {
+        return 1;
+    }
+    if (d >= -64 && d <= 63) {
+        return 2 + 7;
+    }
+    if (d >= -256 && d <= 255) {
+        return 3 + 9;
+    }
+    return 3 + 32;
+}
+
+static unsigned _delta_bits(int32_t v)
+{
+    if (v == 0) {
+        return 1;
+    }
+    if (v >= -8 && v <= 7) {
+        return 2 + 4;
+    }
+    if (v >= -128 && v <= 127) {
+        return 3 + 8;
+    }
+    return 3 + 17;
+}
+
+static void _put_dod(_bitwriter_t *w, int32_t d)
+{
+    switch (_dod_bits(d)) {
+        case 1:
+            _put_bits(w, 0x0, 1);
+            break;
+        case 2 + 7:
+            _put_bits(w, 0x2, 2);
+            _put_bits(w, (uint32_t)d, 7);
+            break;
+        case 3 + 9:
+            _put_bits(w, 0x6, 3);
+            _put_bits(w, (uint32_t)d, 9);
+            break;
+        default:
+            _put_bits(w, 0x7, 3);
+            _put_bits(w, (uint32_t)d, 32);
+            break;
+    }
+}
+
+static void _put_delta(_bitwriter_t *w, int32_t v)
+{
+    switch (_delta_bits(v)) {
+        case 1:
+            _put_bits(w, 0x0, 1);
+            break;
+        case 2 + 4:
+            _put_bits(w, 0x2, 2);
+            _put_bits(w, (uint32_t)v, 4);
+            break;
+        case 3 + 8:
+            _put_bits(w, 0x6, 3);
+            _put_bits(w, (uint32_t)v, 8);
+            break;
+        default:
+            _put_bits(w, 0x7, 3);
+            _put_bits(w, (uint32_t)v, 17);
+            break;
+    }
+}
+
+static const tsbuf_sample_t *_at(const tsbuf_t *b, unsigned i)
+{
+    return &b->samples[(b->head + i) % TSBUF_SIZE];
+}
+
+void tsbuf_init(tsbuf_t *b)
+{
+    memset(b, 0, sizeof(*b));
+}
+
+void tsbuf_push(tsbuf_t *b, uint32_t time, int16_t value)
+{
+    if (b->count == TSBUF_SIZE) {
+        b->head = (b->head + 1) % TSBUF_SIZE;
+        b->count--;
+        b->dropped++;
+    }
+
+    tsbuf_sample_t *s = &b->samples[(b->head + b->count) % TSBUF_SIZE];
+    s->time = time;
+    s->value = value;
+    b->count++;
+}
+
+int tsbuf_encode(const tsbuf_t *b, uint8_t *buf, size_t size, uint8_t index,
+                 uint32_t now, unsigned *encoded)
+{
+    if (b->count == 0) {
+        return -ENODATA;
+    }
+    if (size < TSBUF_HEADER_LEN) {
+        return -ENOBUFS;
+    }
+
+    const tsbuf_sample_t *first = _at(b, 0);
+    uint32_t age = now - first->time;
+    _bitwriter_t w = {
+        .buf = &buf[TSBUF_HEADER_LEN],
+        .bits = (size - TSBUF_HEADER_LEN) * 8,
+        .pos = 0,
+    };
+    unsigned n = 1;
+    int32_t prev_delta = 0;
+
+    memset(w.buf, 0, size - TSBUF_HEADER_LEN);
+
+    buf[0] = PAYLOAD_FRAME_SERIES;
+    buf[1] = index;
+    buf[3] = age >> 24;
+    buf[4] = age >> 16;
+    buf[5] = age >> 8;
+    buf[6] = age;
+    buf[7] = (uint16_t)first->value >> 8;
+    buf[8] = (uint16_t)first->value & 0xff;
+
+    for (; (n < b->count) && (n < BLOCK_MAX_COUNT); n++) {
+        const tsbuf_sample_t *prev = _at(b, n - 1);
+        const tsbuf_sample_t *cur = _at(b, n);
+        int32_t delta = (int32_t)(cur->time - prev->time);
+        int32_t dod = delta - prev_delta;
+        int32_t dv = (int32_t)cur->value - prev->value;
+
+        if (w.pos + _dod_bits(dod) + _delta_bits(dv) > w.bits) {
+            break;
+        }
+        _put_dod(&w, dod);
+        _put_delta(&w, dv);
+        prev_delta = delta;
+    }
+
+    buf[2] = n;
+    *encoded = n;
+
+    return TSBUF_HEADER_LEN + (w.pos + 7) / 8;
+}
+
+void tsbuf_consume(tsbuf_t *b, unsigned n)
+{
+    if (n > b->count) {
+        n = b->count;
+    }
+    b->head = (b->head + n) % TSBUF_SIZE;
+    b->count -= n;
+}
@@ -0,0 +1,154 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Transmission planner of the LoRaWAN uplinks
+ */
+
+#include "txplan.h"
+
+/* bandwidth 0 marks the FSK data rate */
+typedef struct {
+    uint8_t sf;             /* spreading factor */
+    uint16_t bw;            /* bandwidth in kHz */
+    uint8_t max_len;        /* largest application payload, no FOpts */
+} _dr_t;
+
+#ifdef REGION_US915
+static const _dr_t _drs[] = {
+    { 10, 125, 11 },
+    { 9, 125, 53 },
+    { 8, 125, 125 },
+    { 7, 125, 242 },
+    { 8, 500, 242 },
+};
+#else
+static const _dr_t _drs[] = {
+    { 12, 125, 51 },
+    { 11, 125, 51 },
+    { 10, 125, 51 },
+    { 9, 125, 115 },
+    { 8, 125, 222 },
+    { 7, 125, 222 },
+    { 7, 250, 222 },
+    { 0, 0, 222 },
+};
+#endif
+
+#define DR_NUMOF            (sizeof(_drs) / sizeof(_drs[0]))
+
+/* LoRa: 8 preamble symbols, explicit header, CRC on, coding rate 4/5 */
+#define LORA_PREAMBLE       (8U)
+/* FSK at 50 kbps: 160 us per byte, preamble (5), sync word (3), length (1)
+ * and CRC (2) */
+#define FSK_BYTE_US         (160U)
+#define FSK_OVERHEAD        (11U)
+
+static void _refill(txplan_t *p, uint64_t now)
+{
+    uint64_t credit = p->credit;
+
+    if (now > p->updated) {
+        credit += (now - p->updated) * TXPLAN_DUTY_CYCLE / 1000U;
+    }
+    p->credit = (credit > TXPLAN_CREDIT_MAX_US) ? TXPLAN_CREDIT_MAX_US : credit;
+    p->updated = now;
+}
+
+void txplan_init(txplan_t *p, uint64_t now)
+{
+    p->updated = now;
+    p->credit = TXPLAN_CREDIT_MAX_US;
+    p->spent = 0;
+    p->acked = 0;
+    p->heartbeat = 0;
+    p->deferred = 0;
+    p->unacked = 0;
+    p->mode = TXPLAN_MODE_HEARTBEAT;
+}
+
+uint8_t txplan_max_payload(uint8_t dr)
+{
+    return (dr < DR_NUMOF) ? _drs[dr].max_len : 0;
+}
+
+uint32_t txplan_airtime(uint8_t dr, size_t len)
+{
+    if (dr >= DR_NUMOF) {
+        return 0;
+    }
+
+    const _dr_t *r = &_drs[dr];
+    int32_t pl = len + TXPLAN_MAC_OVERHEAD;
+
+    if (r->bw == 0) {
+        return (pl + FSK_OVERHEAD) * FSK_BYTE_US;
+    }
+
+    /* low data rate optimization above 16 ms per symbol */
+    int32_t de = (r->sf >= 11 && r->bw == 125) ? 1 : 0;
+    int32_t num = 8 * pl - 4 * r->sf + 28 + 16;
+    int32_t den = 4 * (r->sf - 2 * de);
+    int32_t blocks = (num > 0) ? (num + den - 1) / den : 0;
+    uint32_t symbols = 8 + blocks * 5;
+    uint32_t tsym = (1000U << r->sf) / r->bw;
+
+    /* preamble of LORA_PREAMBLE + 4.25 symbols */
+    return ((4 * (LORA_PREAMBLE + symbols) + 17) * tsym) / 4;
+}
+
+void txplan_decide(txplan_t *p, uint64_t now, uint8_t dr, size_t len,
+                   unsigned backlog, txplan_decision_t *d)
+{
+    _refill(p, now);
+
+    d->max_len = txplan_max_payload(dr);
+    d->airtime = txplan_airtime(dr, len ? len : d->max_len);
+    d->wait = 0;
+
+    if ((TXPLAN_DUTY_CYCLE > 0) && (d->airtime > p->credit)) {
+        d->wait = (uint64_t)(d->airtime - p->credit) * 1000U / TXPLAN_DUTY_CYCLE;
+    }
+
+    switch (p->mode) {
+        case TXPLAN_MODE_CONFIRMED:
+            d->confirmed = true;
+            break;
+        case TXPLAN_MODE_UNCONFIRMED:
+            d->confirmed = false;
+            break;
+        case TXPLAN_MODE_HEARTBEAT:
+            d->confirmed = (p->heartbeat == 0) ||
+                           (now - p->heartbeat >= TXPLAN_HEARTBEAT_US);
+            break;
+        default:
+            d->confirmed = (backlog == 0) &&
+                           ((TXPLAN_DUTY_CYCLE == 0) ||
+                            (p->credit >= (uint64_t)d->airtime * (1 + TXPLAN_CNF_RESERVE)));
+            break;
+    }
+}
+
+void txplan_spend(txplan_t *p, uint64_t now, uint32_t airtime)
+{
+    _refill(p, now);
+    p->credit = (airtime > p->credit) ? 0 : p->credit - airtime;
+    p->spent += airtime;
+}
+
+void txplan_confirmed(txplan_t *p, uint64_t now, bool acked)
+{
+    /* a lost heartbeat is not retried before the next period, its frame
+     * reached the air and the loss shows in the unacked count */
+    p->heartbeat = now;
+    if (acked) {
+        p->acked = now;
+    }
+    else {
+        p->unacked++;
+    }
+}
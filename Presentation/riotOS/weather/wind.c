@@ -0,0 +1,158 @@
+/*
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Wind vector summary of a window of readings
+ */
+
+#include "wind.h"
+
+/* CORDIC angles are in millidegrees */
+#define MDEG_TURN           (360000)
+#define MDEG_HALF           (180000)
+#define MDEG_QUARTER        (90000)
+/* 1 / gain of the iterations, in Q15 */
+#define CORDIC_SCALE        (19898)
+/* fractional bits of the components */
+#define COMPONENT_FRAC      (8U)
+/* largest magnitude fed to the vectoring, leaves room for the gain */
+#define VECTOR_MAX          ((int64_t)1 << 28)
+
+/* atan(2^-i), in millidegrees */
+static const int32_t _atan[] = {
+    45000, 26565, 14036, 7125, 3576, 1790, 895, 448,
+    224, 112, 56, 28, 14, 7, 3, 2,
+};
+
+#define ITERATIONS          (sizeof(_atan) / sizeof(_atan[0]))
+
+/* rotate (r, 0) by angle in [-90, 90] degrees: x = r cos, y = r sin */
+static void _rotate(int32_t r, int32_t angle, int32_t *x, int32_t *y)
+{
+    int32_t cx = ((int64_t)r * CORDIC_SCALE) >> 15;
+    int32_t cy = 0;
+
+    for (unsigned i = 0; i < ITERATIONS; i++) {
+        int32_t dx = cy >> i;
+        int32_t dy = cx >> i;
+
+        if (angle >= 0) {
+            cx -= dx;
+            cy += dy;
+            angle -= _atan[i];
+        }
+        else {
+            cx += dx;
+            cy -= dy;
+            angle += _atan[i];
+        }
+    }
+    *x = cx;
+    *y = cy;
+}
+
+/* angle of (x, y) for x > 0, in millidegrees in [-90, 90] degrees */
+static int32_t _vector(int32_t x, int32_t y)
+{
+    int32_t angle = 0;
+
+    for (unsigned i = 0; i < ITERATIONS; i++) {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+
+        if (y > 0) {
+            x += dx;
+            y -= dy;
+            angle += _atan[i];
+        }
+        else {
+            x -= dx;
+            y += dy;
+            angle -= _atan[i];
+        }
+    }
+    return angle;
+}
+
+void wind_init(wind_t *w)
+{
+    w->count = 0;
+    w->u = 0;
+    w->v = 0;
+    w->speed = 0;
+    w->gust = 0;
+}
+
+void wind_add(wind_t *w, weather_value_t direction, weather_value_t speed)
+{
+    int32_t angle = ((int32_t)direction * 100) % MDEG_TURN;
+    int32_t r = (speed < 0) ? 0 : speed;
+    int32_t north, east;
+    int sign = 1;
+
+    if (w->count == UINT32_MAX) {
+        return;
+    }
+
+    if (angle < 0) {
+        angle += MDEG_TURN;
+    }
+    /* fold into [-90, 90] degrees, the opposite angle has the opposite
+     * components */
+    if (angle > MDEG_QUARTER && angle < MDEG_TURN - MDEG_QUARTER) {
+        angle -= MDEG_HALF;
+        sign = -1;
+    }
+    else if (angle >= MDEG_TURN - MDEG_QUARTER) {
+        angle -= MDEG_TURN;
+    }
+
+    _rotate(r << COMPONENT_FRAC, angle, &north, &east);
+    w->u += sign * east;
+    w->v += sign * north;
+    w->speed += r;
+    if (r > w->gust) {
+        w->gust = r;
+    }
+    w->count++;
+}
+
+weather_value_t wind_direction(const wind_t *w)
+{
+    int64_t u = w->u;
+    int64_t v = w->v;
+
+    if (u == 0 && v == 0) {
+        return 0;
+    }
+
+    /* only the direction matters, scale the sums down to 32 bit */
+    while (u >= VECTOR_MAX || u <= -VECTOR_MAX || v >= VECTOR_MAX || v <= -VECTOR_MAX) {
+        u /= 2;
+        v /= 2;
+    }
+
+    int32_t angle;
+    if (v > 0) {
+        angle = _vector(v, u);
+    }
+    else if (v < 0) {
+        angle = _vector(-v, -u) + MDEG_HALF;
+    }
+    else {
+        angle = (u > 0) ? MDEG_QUARTER : MDEG_TURN - MDEG_QUARTER;
+    }
+
+    /* round to tenths of degree, in [0, 360) degrees */
+    angle = (angle + MDEG_TURN + 50) % MDEG_TURN;
+    return angle / 100;
+}
+
+weather_value_t wind_speed(const wind_t *w)
+{
+    return w->count ? (w->speed + w->count / 2) / w->count : 0;
+}